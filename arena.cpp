@@ -0,0 +1,77 @@
+#include "arena.h"
+#include <cstdlib>
+#include <new>
+
+namespace yamlman
+{
+    arena::arena(std::size_t block_size) : _head(nullptr), _cur(nullptr), _end(nullptr), _block_size(block_size)
+    {
+    }
+
+    arena::arena(arena&& rhs) noexcept : _head(rhs._head), _cur(rhs._cur), _end(rhs._end), _block_size(rhs._block_size)
+    {
+        rhs._head= nullptr;
+        rhs._cur= nullptr;
+        rhs._end= nullptr;
+    }
+
+    arena::~arena()
+    {
+        while(_head)
+        {
+            block* const next= _head->next;
+
+            std::free(_head);
+            _head= next;
+        }
+    }
+
+    void arena::clear()
+    {
+        if(!_head)
+        {
+            return;
+        }
+
+        while(_head->next)
+        {
+            block* const next= _head->next;
+
+            _head->next= next->next;
+            std::free(next);
+        }
+
+        _cur= reinterpret_cast<char*>(_head + 1);
+        _end= _cur + _head->size;
+    }
+
+    void* arena::grow(std::size_t size, std::size_t align)
+    {
+        // blocks double up to 16 times the initial size; oversized requests get their own
+        std::size_t capacity= _head ? _head->size * 2 : _block_size;
+
+        if(capacity > _block_size * 16)
+        {
+            capacity= _block_size * 16;
+        }
+        if(capacity < size + align)
+        {
+            capacity= size + align;
+        }
+
+        block* const b= static_cast<block*>(std::malloc(sizeof(block) + capacity));
+
+        if(!b)
+        {
+            throw std::bad_alloc();
+        }
+
+        b->next= _head;
+        b->size= capacity;
+        _head= b;
+        _cur= reinterpret_cast<char*>(b + 1);
+        _end= _cur + capacity;
+
+        return allocate(size, align);
+    }
+} // namespace yamlman
@@ -0,0 +1,78 @@
+#ifndef YAMLMAN_ARENA_H_
+#define YAMLMAN_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace yamlman
+{
+    // monotonic bump allocator; memory is only given back all at once, by
+    // clear() or the destructor. objects placed here are never destroyed.
+    class arena
+    {
+        public:
+            explicit arena(std::size_t block_size= 64 * 1024);
+            arena(arena&& rhs) noexcept;
+            ~arena();
+            arena(arena const&)= delete;
+            arena& operator = (arena const&)= delete;
+            arena& operator = (arena&&)= delete;
+        public:
+            void* allocate(std::size_t size, std::size_t align= alignof(std::max_align_t))
+            {
+                std::uintptr_t const p= (reinterpret_cast<std::uintptr_t>(_cur) + align - 1) & ~(align - 1);
+
+                if(p + size > reinterpret_cast<std::uintptr_t>(_end))
+                {
+                    return grow(size, align);
+                }
+
+                _cur= reinterpret_cast<char*>(p + size);
+
+                return reinterpret_cast<void*>(p);
+            }
+
+            template<class T>
+            T* allocate(std::size_t n)
+            {
+                static_assert(std::is_trivially_destructible<T>::value, "arena never runs destructors");
+
+                return static_cast<T*>(allocate(sizeof(T) * n, alignof(T)));
+            }
+
+            std::string_view copy(std::string_view s)
+            {
+                if(s.empty())
+                {
+                    return std::string_view();
+                }
+
+                char* const p= static_cast<char*>(allocate(s.size(), 1));
+
+                std::memcpy(p, s.data(), s.size());
+
+                return std::string_view(p, s.size());
+            }
+
+            // drops everything but the newest block, which is kept for reuse
+            void clear();
+        private:
+            void* grow(std::size_t size, std::size_t align);
+        private:
+            struct block
+            {
+                block* next;
+                std::size_t size;
+            };
+
+            block* _head;
+            char* _cur;
+            char* _end;
+            std::size_t _block_size;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_ARENA_H_
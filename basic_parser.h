@@ -0,0 +1,199 @@
+#ifndef YAMLMAN_BASIC_PARSER_H_
+#define YAMLMAN_BASIC_PARSER_H_
+
+#include "event.h"
+#include "libyaml.h"
+#include <type_traits>
+#include <utility>
+#include <iostream>
+
+namespace yamlman
+{
+    // detects whether a visitor has a member like on_scalar(scalar_event const&)
+#define YAMLMAN_DEFINE_HANDLES(name) \
+    template<class Visitor, class= void> \
+    struct handles_##name : std::false_type{}; \
+    template<class Visitor> \
+    struct handles_##name<Visitor, std::void_t<decltype(std::declval<Visitor&>().on_##name(std::declval<name##_event const&>()))>> : std::true_type{};
+
+    YAMLMAN_DEFINE_HANDLES(stream_start)
+    YAMLMAN_DEFINE_HANDLES(stream_end)
+    YAMLMAN_DEFINE_HANDLES(document_start)
+    YAMLMAN_DEFINE_HANDLES(document_end)
+    YAMLMAN_DEFINE_HANDLES(alias)
+    YAMLMAN_DEFINE_HANDLES(scalar)
+    YAMLMAN_DEFINE_HANDLES(sequence_start)
+    YAMLMAN_DEFINE_HANDLES(sequence_end)
+    YAMLMAN_DEFINE_HANDLES(mapping_start)
+    YAMLMAN_DEFINE_HANDLES(mapping_end)
+
+#undef YAMLMAN_DEFINE_HANDLES
+
+    template<class Visitor, class= void>
+    struct handles_error : std::false_type{};
+    template<class Visitor>
+    struct handles_error<Visitor, std::void_t<decltype(std::declval<Visitor&>().on_error(std::declval<parse_error const&>()))>> : std::true_type{};
+
+    // statically dispatching parser; the visitor implements any subset of
+    // on_stream_start(stream_start_event const&) .. on_mapping_end(mapping_end_event const&),
+    // and on_error(parse_error const&) for the error parsing stops at.
+    // events without a matching member are neither converted nor dispatched.
+    template<class Visitor>
+    class basic_parser
+    {
+        public:
+            basic_parser(std::istream& istream, Visitor& visitor) : _parser(make_parser(istream)), _visitor(visitor)
+            {
+            }
+            basic_parser(char const* data, std::size_t size, Visitor& visitor) : _parser(make_parser(data, size)), _visitor(visitor)
+            {
+            }
+            basic_parser(basic_parser const&)= delete;
+            basic_parser& operator = (basic_parser const&)= delete;
+        public:
+            Visitor& visitor() const
+            {
+                return _visitor;
+            }
+
+            // false on a parse error
+            bool parse()
+            {
+                auto deleter= [](yaml_event_t* event){
+                    if(event)
+                    {
+                        yaml_event_delete(event);
+                    }
+                };
+                typedef std::unique_ptr<yaml_event_t, decltype(deleter)> lp_event_t;
+
+                yaml_event_t event;
+                bool done= false;
+
+                while(!done)
+                {
+                    if(!yaml_parser_parse(_parser.get(), &event))
+                    {
+                        if constexpr(handles_error<Visitor>::value)
+                        {
+                            _visitor.on_error(make_error(*_parser));
+                        }
+                        return false;
+                    }
+
+                    lp_event_t pevent(&event, deleter);
+
+                    dispatch(event);
+
+                    done= (event.type == YAML_STREAM_END_EVENT);
+                }
+
+                return true;
+            }
+        private:
+            void dispatch(yaml_event_t const& event)
+            {
+                switch(event.type)
+                {
+                    case YAML_STREAM_START_EVENT:
+                        if constexpr(handles_stream_start<Visitor>::value)
+                        {
+                            stream_start_event e;
+
+                            fill(event, e);
+                            _visitor.on_stream_start(e);
+                        }
+                        break;
+                    case YAML_STREAM_END_EVENT:
+                        if constexpr(handles_stream_end<Visitor>::value)
+                        {
+                            stream_end_event e;
+
+                            fill(event, e);
+                            _visitor.on_stream_end(e);
+                        }
+                        break;
+                    case YAML_DOCUMENT_START_EVENT:
+                        if constexpr(handles_document_start<Visitor>::value)
+                        {
+                            document_start_event e;
+
+                            fill(event, e);
+                            _visitor.on_document_start(e);
+                        }
+                        break;
+                    case YAML_DOCUMENT_END_EVENT:
+                        if constexpr(handles_document_end<Visitor>::value)
+                        {
+                            document_end_event e;
+
+                            fill(event, e);
+                            _visitor.on_document_end(e);
+                        }
+                        break;
+                    case YAML_ALIAS_EVENT:
+                        if constexpr(handles_alias<Visitor>::value)
+                        {
+                            alias_event e;
+
+                            fill(event, e);
+                            _visitor.on_alias(e);
+                        }
+                        break;
+                    case YAML_SCALAR_EVENT:
+                        if constexpr(handles_scalar<Visitor>::value)
+                        {
+                            scalar_event e;
+
+                            fill(event, e);
+                            _visitor.on_scalar(e);
+                        }
+                        break;
+                    case YAML_SEQUENCE_START_EVENT:
+                        if constexpr(handles_sequence_start<Visitor>::value)
+                        {
+                            sequence_start_event e;
+
+                            fill(event, e);
+                            _visitor.on_sequence_start(e);
+                        }
+                        break;
+                    case YAML_SEQUENCE_END_EVENT:
+                        if constexpr(handles_sequence_end<Visitor>::value)
+                        {
+                            sequence_end_event e;
+
+                            fill(event, e);
+                            _visitor.on_sequence_end(e);
+                        }
+                        break;
+                    case YAML_MAPPING_START_EVENT:
+                        if constexpr(handles_mapping_start<Visitor>::value)
+                        {
+                            mapping_start_event e;
+
+                            fill(event, e);
+                            _visitor.on_mapping_start(e);
+                        }
+                        break;
+                    case YAML_MAPPING_END_EVENT:
+                        if constexpr(handles_mapping_end<Visitor>::value)
+                        {
+                            mapping_end_event e;
+
+                            fill(event, e);
+                            _visitor.on_mapping_end(e);
+                        }
+                        break;
+                    case YAML_NO_EVENT:
+                    default:
+                        break;
+                }
+            }
+        private:
+            lp_parser_t _parser;
+            Visitor& _visitor;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_BASIC_PARSER_H_
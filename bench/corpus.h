@@ -0,0 +1,120 @@
+#ifndef YAMLMAN_BENCH_CORPUS_H_
+#define YAMLMAN_BENCH_CORPUS_H_
+
+#include <string>
+
+// synthetic inputs, generated on first use; each is a few MB
+namespace corpus
+{
+    // one mapping with many scalar pairs
+    inline std::string const& wide_flat_map()
+    {
+        static std::string const res= []{
+            std::string s;
+
+            for(int i= 0; i < 100000; ++i)
+            {
+                s+= "key_" + std::to_string(i) + ": value " + std::to_string(i * 7) + "\n";
+            }
+
+            return s;
+        }();
+
+        return res;
+    }
+
+    // many short chains of nested block mappings
+    inline std::string const& deep_nesting()
+    {
+        static std::string const res= []{
+            std::string s;
+
+            for(int i= 0; i < 2000; ++i)
+            {
+                std::string indent;
+
+                s+= "- ";
+                for(int depth= 0; depth < 40; ++depth)
+                {
+                    s+= "level" + std::to_string(depth) + ":\n";
+                    indent+= "  ";
+                    s+= "  " + indent;
+                }
+                s+= "leaf: " + std::to_string(i) + "\n";
+            }
+
+            return s;
+        }();
+
+        return res;
+    }
+
+    // literal block scalars of a few KB each
+    inline std::string const& long_block_scalars()
+    {
+        static std::string const res= []{
+            std::string s;
+            std::string const line= "    the quick brown fox jumps over the lazy dog 0123456789\n";
+
+            for(int i= 0; i < 500; ++i)
+            {
+                s+= "text" + std::to_string(i) + ": |\n";
+                for(int j= 0; j < 80; ++j)
+                {
+                    s+= line;
+                }
+            }
+
+            return s;
+        }();
+
+        return res;
+    }
+
+    // a stream of small independent documents, like our log shipping input
+    inline std::string const& many_small_docs()
+    {
+        static std::string const res= []{
+            std::string s;
+
+            for(int i= 0; i < 20000; ++i)
+            {
+                s+= "---\n";
+                s+= "id: " + std::to_string(i) + "\n";
+                s+= "level: info\n";
+                s+= "message: \"request " + std::to_string(i) + " served\"\n";
+                s+= "tags: [http, v2]\n";
+            }
+
+            return s;
+        }();
+
+        return res;
+    }
+
+    // shared defaults referenced from many records
+    inline std::string const& alias_heavy()
+    {
+        static std::string const res= []{
+            std::string s;
+
+            s+= "defaults: &defaults\n";
+            s+= "  timeout: 30\n";
+            s+= "  retries: 3\n";
+            s+= "  tier: &tier backend\n";
+            s+= "records:\n";
+            for(int i= 0; i < 30000; ++i)
+            {
+                s+= "  - name: r" + std::to_string(i) + "\n";
+                s+= "    base: *defaults\n";
+                s+= "    tier: *tier\n";
+            }
+
+            return s;
+        }();
+
+        return res;
+    }
+} // namespace corpus
+
+#endif // YAMLMAN_BENCH_CORPUS_H_
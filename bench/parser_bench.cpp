@@ -0,0 +1,551 @@
+#include "../parser.h"
+#include "../basic_parser.h"
+#include "../document.h"
+#include "../parallel_parser.h"
+#include "../emitter.h"
+#include "../event_tape.h"
+#include "../symbol_table.h"
+#include "corpus.h"
+#include <benchmark/benchmark.h>
+#include <yaml.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+// every heap allocation of the process, libyaml's included, goes through here
+namespace
+{
+    std::atomic<std::size_t> allocations(0);
+} // namespace
+
+#ifdef __GLIBC__
+extern "C"
+{
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t n, std::size_t size);
+    void* __libc_realloc(void* p, std::size_t size);
+
+    void* malloc(std::size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t n, std::size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(n, size);
+    }
+
+    void* realloc(void* p, std::size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(p, size);
+    }
+}
+#endif
+
+namespace
+{
+    typedef std::string const& (*corpus_t)();
+
+    // reports MB/s, events/s and heap allocations per event
+    class meter
+    {
+        public:
+            meter(benchmark::State& state, std::string const& input) : _state(state), _input(input), _events(0), _consumed(0), _partial(false), _allocations(allocations.load())
+            {
+            }
+            ~meter()
+            {
+                std::size_t const allocated= allocations.load() - _allocations;
+
+                _state.SetBytesProcessed(_partial ? _consumed : _state.iterations() * _input.size());
+                _state.counters["events/s"]= benchmark::Counter(_events, benchmark::Counter::kIsRate);
+                // the parser's setup dwarfs the few events of a partial read
+                if(!_partial)
+                {
+                    _state.counters["allocs/event"]= _events ? static_cast<double>(allocated) / _events : 0.0;
+                }
+            }
+        public:
+            void count(std::size_t events){ _events+= events; }
+            // for benches that stop short of the input's end: bytes actually read
+            void consumed(std::size_t bytes)
+            {
+                _consumed+= bytes;
+                _partial= true;
+            }
+        private:
+            benchmark::State& _state;
+            std::string const& _input;
+            std::size_t _events;
+            std::size_t _consumed;
+            bool _partial;
+            std::size_t const _allocations;
+    };
+
+    void subscribe_all(yamlman::parser& parser, std::size_t& n)
+    {
+        using namespace yamlman;
+
+        parser
+            .on_stream_start([&n](stream_start_event const&){ ++n; })
+            .on_stream_end([&n](stream_end_event const&){ ++n; })
+            .on_document_start([&n](document_start_event const&){ ++n; })
+            .on_document_end([&n](document_end_event const&){ ++n; })
+            .on_alias([&n](alias_event const&){ ++n; })
+            .on_scalar([&n](scalar_event const&){ ++n; })
+            .on_sequence_start([&n](sequence_start_event const&){ ++n; })
+            .on_sequence_end([&n](sequence_end_event const&){ ++n; })
+            .on_mapping_start([&n](mapping_start_event const&){ ++n; })
+            .on_mapping_end([&n](mapping_end_event const&){ ++n; })
+        ;
+    }
+
+    // events libyaml reports for an input, for benches that don't see events
+    std::size_t events_in(std::string const& input)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        while(parser.next())
+        {
+            ++n;
+        }
+
+        return n;
+    }
+
+    struct counting_visitor
+    {
+        std::size_t n= 0;
+
+        void on_stream_start(yamlman::stream_start_event const&){ ++n; }
+        void on_stream_end(yamlman::stream_end_event const&){ ++n; }
+        void on_document_start(yamlman::document_start_event const&){ ++n; }
+        void on_document_end(yamlman::document_end_event const&){ ++n; }
+        void on_alias(yamlman::alias_event const&){ ++n; }
+        void on_scalar(yamlman::scalar_event const&){ ++n; }
+        void on_sequence_start(yamlman::sequence_start_event const&){ ++n; }
+        void on_sequence_end(yamlman::sequence_end_event const&){ ++n; }
+        void on_mapping_start(yamlman::mapping_start_event const&){ ++n; }
+        void on_mapping_end(yamlman::mapping_end_event const&){ ++n; }
+    };
+} // namespace
+
+// the floor: libyaml alone over the same in-memory input
+static void raw_libyaml(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yaml_parser_t parser;
+        yaml_event_t event;
+        std::size_t n= 0;
+        bool done= false;
+
+        yaml_parser_initialize(&parser);
+        yaml_parser_set_input_string(&parser, reinterpret_cast<unsigned char const*>(input.data()), input.size());
+        while(!done && yaml_parser_parse(&parser, &event))
+        {
+            done= (event.type == YAML_STREAM_END_EVENT);
+            yaml_event_delete(&event);
+            ++n;
+        }
+        yaml_parser_delete(&parser);
+
+        meter.count(n);
+    }
+}
+
+static void callback_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.parse();
+
+        meter.count(n);
+    }
+}
+
+// same handlers with tags and anchors interned; alias_heavy has the most of them
+static void interned_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+    yamlman::symbol_table symbols;
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.symbols(&symbols).parse();
+
+        meter.count(n);
+    }
+}
+
+// same handlers without marks; the gap to callback_parser is what filling them costs
+static void unmarked_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.marks(yamlman::mark_mode::none).parse();
+
+        meter.count(n);
+    }
+}
+
+// same handlers on the vectorized subset scanner; corpora outside the subset
+// measure the cost of the check before falling back to libyaml
+static void fast_path_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.backend(yamlman::backend::fast_path).parse();
+
+        meter.count(n);
+    }
+}
+
+// same handlers, with parsing moved to a second thread
+static void pipelined_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.parse(yamlman::pipeline_options());
+
+        meter.count(n);
+    }
+}
+
+// the same events replayed from a tape recorded beforehand; marks carry their
+// index only, as no line_index is attached
+static void tape_replay(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+    yamlman::tape_writer writer;
+    std::ostringstream tape;
+
+    yamlman::parser(input).on_event([&writer](yamlman::event const& e){ writer.add(e); }).parse();
+    writer.write(tape, yamlman::source_hash(input.data(), input.size()));
+
+    std::string const recorded= tape.str();
+
+    for(auto _ : state)
+    {
+        yamlman::tape_reader reader(recorded.data(), recorded.size());
+        yamlman::parser parser(reader);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.parse();
+
+        meter.count(n);
+    }
+    state.counters["tape/source"]= static_cast<double>(recorded.size()) / input.size();
+}
+
+// callback_parser with the counters and timers on
+static void stats_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+    yamlman::parser_stats stats;
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.stats(&stats).parse();
+
+        meter.count(n);
+    }
+    state.counters["parse_share"]= static_cast<double>(stats.parse_ns) / (stats.parse_ns + stats.convert_ns + stats.handler_ns);
+}
+
+// fed in 4 KiB pieces, as they would come off a socket
+static void pushed_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser;
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        for(std::size_t i= 0; i < input.size(); i+= 4096)
+        {
+            parser.feed(input.data() + i, std::min<std::size_t>(4096, input.size() - i));
+        }
+        parser.finish();
+
+        meter.count(n);
+    }
+}
+
+static void callback_parser_istream(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        std::istringstream in(input);
+        yamlman::parser parser(in);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.parse();
+
+        meter.count(n);
+    }
+}
+
+static void pull_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        while(parser.next())
+        {
+            ++n;
+        }
+
+        meter.count(n);
+    }
+}
+
+// parse and write back out; the matched pair to the readers above
+static void round_trip(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+    std::string output;
+
+    output.reserve(input.size() * 2);
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        output.clear();
+        {
+            yamlman::emitter emitter(output);
+
+            while(yamlman::event const* e= parser.next())
+            {
+                emitter.emit(*e);
+                ++n;
+            }
+        }
+
+        meter.count(n);
+    }
+}
+
+static void static_parser(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        counting_visitor visitor;
+        yamlman::basic_parser<counting_visitor> parser(input.data(), input.size(), visitor);
+
+        parser.parse();
+
+        meter.count(visitor.n);
+    }
+}
+
+static void document_tree(benchmark::State& state, corpus_t corpus)
+{
+    std::string const& input= corpus();
+    std::size_t const events= events_in(input);
+    meter meter(state, input);
+    yamlman::alias_limits limits;
+
+    // alias_heavy is benign, just large
+    limits.max_aliases= 1000000;
+    limits.max_expansion= 100000000;
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        yamlman::document document(limits);
+
+        while(document.load(parser))
+        {
+            benchmark::DoNotOptimize(&document.root());
+        }
+
+        meter.count(events);
+    }
+}
+
+#define YAMLMAN_BENCH_CORPORA_WITH(bench, options) \
+    BENCHMARK_CAPTURE(bench, wide_flat_map, corpus::wide_flat_map)->Unit(benchmark::kMillisecond)options; \
+    BENCHMARK_CAPTURE(bench, deep_nesting, corpus::deep_nesting)->Unit(benchmark::kMillisecond)options; \
+    BENCHMARK_CAPTURE(bench, long_block_scalars, corpus::long_block_scalars)->Unit(benchmark::kMillisecond)options; \
+    BENCHMARK_CAPTURE(bench, many_small_docs, corpus::many_small_docs)->Unit(benchmark::kMillisecond)options; \
+    BENCHMARK_CAPTURE(bench, alias_heavy, corpus::alias_heavy)->Unit(benchmark::kMillisecond)options
+#define YAMLMAN_BENCH_CORPORA(bench) YAMLMAN_BENCH_CORPORA_WITH(bench, )
+
+YAMLMAN_BENCH_CORPORA(raw_libyaml);
+YAMLMAN_BENCH_CORPORA(callback_parser);
+YAMLMAN_BENCH_CORPORA(unmarked_parser);
+YAMLMAN_BENCH_CORPORA(interned_parser);
+YAMLMAN_BENCH_CORPORA(stats_parser);
+YAMLMAN_BENCH_CORPORA(tape_replay);
+YAMLMAN_BENCH_CORPORA(fast_path_parser);
+// cpu time would only count the calling thread, not the parsing one
+YAMLMAN_BENCH_CORPORA_WITH(pipelined_parser, ->UseRealTime());
+YAMLMAN_BENCH_CORPORA(callback_parser_istream);
+YAMLMAN_BENCH_CORPORA(pushed_parser);
+YAMLMAN_BENCH_CORPORA(pull_parser);
+YAMLMAN_BENCH_CORPORA(static_parser);
+YAMLMAN_BENCH_CORPORA(document_tree);
+YAMLMAN_BENCH_CORPORA(round_trip);
+
+// independent documents split across threads; state.range(0) threads
+static void parallel_small_docs(benchmark::State& state)
+{
+    std::string const& input= corpus::many_small_docs();
+    meter meter(state, input);
+    yamlman::parallel_options options;
+
+    options.threads= state.range(0);
+    options.chunk_size= 256 * 1024;
+
+    for(auto _ : state)
+    {
+        yamlman::parallel_parser parser(input.data(), input.size(), options);
+        std::size_t n= 0;
+
+        parser.on_event([&n](std::size_t, yamlman::event const&){ ++n; });
+        parser.parse();
+
+        meter.count(n);
+    }
+}
+BENCHMARK(parallel_small_docs)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// parse_all_subscribed and parse_scalar_subscribed are a pair over the same
+// corpus: every kind converted and dispatched, against only scalars. libyaml's
+// scanner dominates both and converting an event costs little next to it, so
+// they land within noise of each other; the pair shows that the check before
+// conversion costs nothing, not that skipping makes parsing faster
+static void parse_all_subscribed(benchmark::State& state)
+{
+    std::string const& input= corpus::many_small_docs();
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        subscribe_all(parser, n);
+        parser.parse();
+
+        meter.count(n);
+    }
+}
+BENCHMARK(parse_all_subscribed)->Unit(benchmark::kMillisecond);
+
+static void parse_scalar_subscribed(benchmark::State& state)
+{
+    std::string const& input= corpus::many_small_docs();
+    std::size_t const events= events_in(input);
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        parser.on_scalar([&n](yamlman::scalar_event const&){ ++n; });
+        parser.parse();
+
+        benchmark::DoNotOptimize(n);
+        meter.count(events);
+    }
+}
+BENCHMARK(parse_scalar_subscribed)->Unit(benchmark::kMillisecond);
+
+// one key out of the wide map, near its start and at its end; events
+// outside it are neither converted nor dispatched, and parsing stops after it
+static void select_one_key(benchmark::State& state)
+{
+    std::string const& input= corpus::wide_flat_map();
+    std::string const key= "key_" + std::to_string(state.range(0));
+    meter meter(state, input);
+
+    for(auto _ : state)
+    {
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+        // the input is ascii, so the index of the last mark is in bytes
+        std::uint64_t end= 0;
+
+        parser.on_event([&](yamlman::event const& e){
+            ++n;
+            end= e.base()->end_mark().index();
+        });
+        parser.select(key).parse();
+
+        benchmark::DoNotOptimize(n);
+        meter.count(n);
+        meter.consumed(end);
+    }
+}
+BENCHMARK(select_one_key)->Arg(100)->Arg(99999)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,247 @@
+#include "document.h"
+#include "parser.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace yamlman
+{
+    node const* node::find(std::string_view key) const
+    {
+        if(_type != node_type::mapping)
+        {
+            return nullptr;
+        }
+
+        for(std::size_t i= 0; i < _size; ++i)
+        {
+            node const& k= _children[i * 2];
+
+            if(k._type == node_type::scalar && k._value == key)
+            {
+                return &_children[i * 2 + 1];
+            }
+        }
+
+        return nullptr;
+    }
+
+    namespace
+    {
+        // what a finished node adds to a full traversal of the tree
+        struct expansion
+        {
+            std::size_t nodes;
+            std::size_t depth;
+        };
+
+        struct anchor_entry
+        {
+            node const** slot;
+            expansion size;
+            bool complete;
+        };
+    } // namespace
+
+    document::document(alias_limits const& limits) : _limits(limits), _root(nullptr)
+    {
+    }
+
+    bool document::load(parser& parser)
+    {
+        event const* e;
+
+        do
+        {
+            e= parser.next();
+        }
+        while(e && e->type() != event_type::document_start && e->type() != event_type::stream_end);
+
+        if(!e || e->type() == event_type::stream_end)
+        {
+            return false;
+        }
+
+        _arena.clear();
+        _root= nullptr;
+
+        // finished nodes wait here until their parent collection ends and
+        // moves them, contiguously, into the arena
+        std::vector<node> nodes;
+        std::vector<expansion> sizes;
+        std::vector<std::pair<std::size_t, node>> open;
+        std::unordered_map<std::string_view, anchor_entry> anchors;
+        std::size_t aliases= 0, expanded= 0;
+
+        // a node with an anchor gets a slot for its final address, which
+        // is only known once its parent collection has been moved
+        auto const anchor= [&](node& n){
+            if(!n._anchor.empty())
+            {
+                n._slot= _arena.allocate<node const*>(1);
+                *n._slot= nullptr;
+                anchors[n._anchor]= anchor_entry{n._slot, expansion{0, 0}, false};
+            }
+        };
+        auto const complete= [&](node const& n, expansion size){
+            if(n._slot)
+            {
+                auto const it= anchors.find(n._anchor);
+
+                // unless the anchor was redefined inside the node
+                if(it != anchors.end() && it->second.slot == n._slot)
+                {
+                    it->second.size= size;
+                    it->second.complete= true;
+                }
+            }
+        };
+        auto const place= [](node* dst, node const* first, node const* last){
+            for(; first != last; ++first, ++dst)
+            {
+                *dst= *first;
+
+                if(dst->_slot && dst->_type != node_type::alias)
+                {
+                    *dst->_slot= dst;
+                }
+            }
+        };
+        auto const grow= [&](std::size_t n){
+            expanded+= n;
+
+            if(expanded > _limits.max_expansion)
+            {
+                throw document_error("yamlman: alias expansion exceeds the limit");
+            }
+        };
+
+        while((e= parser.next()))
+        {
+            switch(e->type())
+            {
+                case event_type::scalar:{
+                    scalar_event const& ev= e->get<scalar_event>();
+                    node n= node();
+
+                    n._type= node_type::scalar;
+                    n._style= ev.style();
+                    n._anchor= _arena.copy(ev.anchor());
+                    n._tag= _arena.copy(ev.tag());
+                    n._value= _arena.copy(ev.value());
+                    n._start= ev.start_mark();
+                    anchor(n);
+                    complete(n, expansion{1, 0});
+                    grow(1);
+                    nodes.push_back(n);
+                    sizes.push_back(expansion{1, 0});
+                    break;
+                }
+                case event_type::alias:{
+                    alias_event const& ev= e->get<alias_event>();
+                    auto const it= anchors.find(ev.anchor());
+
+                    if(it == anchors.end())
+                    {
+                        throw document_error("yamlman: unknown anchor '" + std::string(ev.anchor()) + "'");
+                    }
+                    if(!it->second.complete)
+                    {
+                        throw document_error("yamlman: recursive alias '" + std::string(ev.anchor()) + "'");
+                    }
+                    if(++aliases > _limits.max_aliases)
+                    {
+                        throw document_error("yamlman: too many aliases");
+                    }
+
+                    expansion const size{it->second.size.nodes, it->second.size.depth + 1};
+
+                    if(size.depth > _limits.max_depth)
+                    {
+                        throw document_error("yamlman: aliases nested too deep");
+                    }
+                    grow(size.nodes);
+
+                    node n= node();
+
+                    n._type= node_type::alias;
+                    n._value= it->first;
+                    n._slot= it->second.slot;
+                    n._start= ev.start_mark();
+                    nodes.push_back(n);
+                    sizes.push_back(size);
+                    break;
+                }
+                case event_type::sequence_start:{
+                    sequence_start_event const& ev= e->get<sequence_start_event>();
+                    node n= node();
+
+                    n._type= node_type::sequence;
+                    n._anchor= _arena.copy(ev.anchor());
+                    n._tag= _arena.copy(ev.tag());
+                    n._start= ev.start_mark();
+                    anchor(n);
+                    grow(1);
+                    open.emplace_back(nodes.size(), n);
+                    break;
+                }
+                case event_type::mapping_start:{
+                    mapping_start_event const& ev= e->get<mapping_start_event>();
+                    node n= node();
+
+                    n._type= node_type::mapping;
+                    n._anchor= _arena.copy(ev.anchor());
+                    n._tag= _arena.copy(ev.tag());
+                    n._start= ev.start_mark();
+                    anchor(n);
+                    grow(1);
+                    open.emplace_back(nodes.size(), n);
+                    break;
+                }
+                case event_type::sequence_end:
+                case event_type::mapping_end:{
+                    std::size_t const first= open.back().first;
+                    node n= open.back().second;
+                    std::size_t const count= nodes.size() - first;
+                    node* const children= _arena.allocate<node>(count);
+                    expansion size{1, 0};
+
+                    place(children, nodes.data() + first, nodes.data() + nodes.size());
+                    n._children= children;
+                    n._size= (n._type == node_type::mapping) ? count / 2 : count;
+
+                    for(std::size_t i= first; i < sizes.size(); ++i)
+                    {
+                        size.nodes+= sizes[i].nodes;
+                        size.depth= std::max(size.depth, sizes[i].depth);
+                    }
+                    complete(n, size);
+
+                    open.pop_back();
+                    nodes.resize(first);
+                    sizes.resize(first);
+                    nodes.push_back(n);
+                    sizes.push_back(size);
+                    break;
+                }
+                case event_type::document_end:{
+                    node* const root= _arena.allocate<node>(1);
+
+                    place(root, &nodes.back(), &nodes.back() + 1);
+                    _root= root;
+                    return true;
+                }
+                default:
+                    break;
+            }
+        }
+
+        if(parse_error const* err= parser.error())
+        {
+            throw *err;
+        }
+        throw document_error("yamlman: input ended in the middle of a document");
+    }
+} // namespace yamlman
@@ -0,0 +1,101 @@
+#ifndef YAMLMAN_DOCUMENT_H_
+#define YAMLMAN_DOCUMENT_H_
+
+#include "event.h"
+#include "arena.h"
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+namespace yamlman
+{
+    class parser;
+
+    enum class node_type
+    {
+        scalar,
+        sequence,
+        mapping,
+        alias,
+    };
+
+    // a node of a document tree; nodes and their text live in the document's arena.
+    // a collection's children are stored contiguously, a mapping as key, value, key, value...
+    class node
+    {
+            friend class document;
+        public:
+            node_type type() const{ return _type; }
+            std::string_view anchor() const{ return _anchor; }
+            std::string_view tag() const{ return _tag; }
+            mark start_mark() const{ return _start; }
+            // scalar value, or the anchor an alias refers to
+            std::string_view value() const{ return _value; }
+            // the anchored node an alias refers to; shared, not copied
+            node const* target() const{ return _type == node_type::alias ? *_slot : nullptr; }
+            scalar_style style() const{ return _style; }
+            // number of sequence items or mapping pairs
+            std::size_t size() const{ return _size; }
+            // i-th sequence item, or the value of the i-th mapping pair
+            node const& item(std::size_t i) const
+            {
+                return _type == node_type::mapping ? _children[i * 2 + 1] : _children[i];
+            }
+            // key of the i-th mapping pair
+            node const& key(std::size_t i) const{ return _children[i * 2]; }
+            // value for a scalar key in a mapping, nullptr if there is none
+            node const* find(std::string_view key) const;
+        private:
+            node_type _type;
+            scalar_style _style;
+            std::string_view _anchor, _tag, _value;
+            node const* _children;
+            std::size_t _size;
+            // anchored nodes publish their final address here; aliases read it
+            node const** _slot;
+            mark _start;
+    };
+
+    class document_error : public std::runtime_error
+    {
+        public:
+            explicit document_error(std::string const& what) : std::runtime_error(what){}
+    };
+
+    // bounds on what aliases may add to a document, against billion-laughs inputs
+    struct alias_limits
+    {
+        // alias nodes per document
+        std::size_t max_aliases= 10000;
+        // nodes a full traversal would visit, counting each aliased subtree every time it's referenced
+        std::size_t max_expansion= 1000000;
+        // aliases nested in aliased subtrees
+        std::size_t max_depth= 32;
+    };
+
+    // tree built from the parser's events. aliases resolve to the anchored node itself,
+    // so repeated subtrees are shared; recursive and unknown aliases are rejected.
+    // freeing a document releases its arena blocks in one go, no matter how many nodes it holds.
+    class document
+    {
+        public:
+            explicit document(alias_limits const& limits= alias_limits());
+            document(document&& rhs)= default;
+            document(document const&)= delete;
+            document& operator = (document const&)= delete;
+        public:
+            // reads the next document of the stream, replacing the current tree;
+            // false when the stream has no more documents.
+            // throws document_error when the input ends in the middle of a document,
+            // on unknown or recursive aliases, and when an alias limit is exceeded;
+            // throws the parser's parse_error when the document is malformed.
+            bool load(parser& parser);
+            node const& root() const{ return *_root; }
+        private:
+            alias_limits _limits;
+            arena _arena;
+            node const* _root;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_DOCUMENT_H_
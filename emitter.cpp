@@ -0,0 +1,502 @@
+#include "emitter.h"
+#include <yaml.h>
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+
+namespace yamlman
+{
+    namespace
+    {
+        // yamlman's enums list the styles in libyaml's order
+        yaml_encoding_t convert(yamlman::encoding val)
+        {
+            static_assert(static_cast<int>(encoding::utf16be) == YAML_UTF16BE_ENCODING, "encoding order");
+
+            return static_cast<yaml_encoding_t>(val);
+        }
+
+        yaml_scalar_style_t convert(scalar_style val)
+        {
+            static_assert(static_cast<int>(scalar_style::folded) == YAML_FOLDED_SCALAR_STYLE, "scalar_style order");
+
+            return static_cast<yaml_scalar_style_t>(val);
+        }
+
+        // the sequence and mapping styles share their values
+        yaml_sequence_style_t to_sequence_style(collection_style val)
+        {
+            static_assert(static_cast<int>(collection_style::flow) == YAML_FLOW_SEQUENCE_STYLE, "collection_style order");
+
+            return static_cast<yaml_sequence_style_t>(val);
+        }
+
+        yaml_mapping_style_t to_mapping_style(collection_style val)
+        {
+            static_assert(static_cast<int>(collection_style::flow) == YAML_FLOW_MAPPING_STYLE, "collection_style order");
+
+            return static_cast<yaml_mapping_style_t>(val);
+        }
+    } // namespace
+
+    class emitter::impl
+    {
+        private:
+            enum class sink
+            {
+                ostream,
+                fd,
+                string,
+            };
+
+            // bytes collected before the ostream or fd sees a write
+            static std::size_t const buffer_size= 256 * 1024;
+        public:
+            explicit impl(std::ostream& ostream) : _sink(sink::ostream), _ostream(&ostream), _fd(-1), _output(&_buffer)
+            {
+                initialize();
+            }
+            explicit impl(int fd) : _sink(sink::fd), _ostream(nullptr), _fd(fd), _output(&_buffer)
+            {
+                initialize();
+            }
+            // a string sink is its own buffer
+            explicit impl(std::string& buffer) : _sink(sink::string), _ostream(nullptr), _fd(-1), _output(&buffer)
+            {
+                initialize();
+            }
+            ~impl()
+            {
+                try
+                {
+                    flush();
+                }
+                catch(...)
+                {
+                }
+                yaml_emitter_delete(&_emitter);
+            }
+        public:
+            void indent(int val)
+            {
+                yaml_emitter_set_indent(&_emitter, val);
+            }
+
+            void width(int val)
+            {
+                yaml_emitter_set_width(&_emitter, val);
+            }
+
+            void unicode(bool val)
+            {
+                yaml_emitter_set_unicode(&_emitter, val);
+            }
+
+            void canonical(bool val)
+            {
+                yaml_emitter_set_canonical(&_emitter, val);
+            }
+
+            void stream_start(yamlman::encoding encoding)
+            {
+                yaml_event_t event;
+
+                yaml_stream_start_event_initialize(&event, convert(encoding));
+                emit(event);
+            }
+
+            void stream_end()
+            {
+                yaml_event_t event;
+
+                yaml_stream_end_event_initialize(&event);
+                emit(event);
+            }
+
+            void document_start(bool implicit, int version_major, int version_minor)
+            {
+                yaml_event_t event;
+                yaml_version_directive_t version= {version_major, version_minor};
+
+                yaml_document_start_event_initialize(&event, (version_major || version_minor) ? &version : nullptr, nullptr, nullptr, implicit);
+                emit(event);
+            }
+
+            void document_end(bool implicit)
+            {
+                yaml_event_t event;
+
+                yaml_document_end_event_initialize(&event, implicit);
+                emit(event);
+            }
+
+            void alias(std::string_view anchor)
+            {
+                yaml_event_t event;
+
+                if(!yaml_alias_event_initialize(&event, terminate(_anchor, anchor)))
+                {
+                    throw emitter_error("alias without an anchor");
+                }
+                emit(event);
+            }
+
+            void scalar(std::string_view value, scalar_style style, std::string_view anchor, std::string_view tag, bool plain_implicit, bool quoted_implicit)
+            {
+                yaml_event_t event;
+
+                if(!yaml_scalar_event_initialize(
+                    &event,
+                    terminate(_anchor, anchor),
+                    terminate(_tag, tag),
+                    reinterpret_cast<yaml_char_t*>(const_cast<char*>(value.data() ? value.data() : "")),
+                    static_cast<int>(value.size()),
+                    plain_implicit,
+                    quoted_implicit,
+                    convert(style)
+                ))
+                {
+                    throw emitter_error("invalid scalar");
+                }
+                emit(event);
+            }
+
+            void sequence_start(collection_style style, std::string_view anchor, std::string_view tag, bool implicit)
+            {
+                yaml_event_t event;
+
+                if(!yaml_sequence_start_event_initialize(&event, terminate(_anchor, anchor), terminate(_tag, tag), implicit, to_sequence_style(style)))
+                {
+                    throw emitter_error("invalid sequence start");
+                }
+                emit(event);
+            }
+
+            void sequence_end()
+            {
+                yaml_event_t event;
+
+                yaml_sequence_end_event_initialize(&event);
+                emit(event);
+            }
+
+            void mapping_start(collection_style style, std::string_view anchor, std::string_view tag, bool implicit)
+            {
+                yaml_event_t event;
+
+                if(!yaml_mapping_start_event_initialize(&event, terminate(_anchor, anchor), terminate(_tag, tag), implicit, to_mapping_style(style)))
+                {
+                    throw emitter_error("invalid mapping start");
+                }
+                emit(event);
+            }
+
+            void mapping_end()
+            {
+                yaml_event_t event;
+
+                yaml_mapping_end_event_initialize(&event);
+                emit(event);
+            }
+
+            void flush()
+            {
+                // libyaml picks the encoding at the stream start; nothing to flush before it
+                if(_emitter.encoding && !yaml_emitter_flush(&_emitter))
+                {
+                    fail();
+                }
+                drain();
+                if(_sink == sink::ostream)
+                {
+                    _ostream->flush();
+                }
+            }
+        private:
+            void initialize()
+            {
+                yaml_emitter_initialize(&_emitter);
+                yaml_emitter_set_output(&_emitter, &impl::write, this);
+                if(_sink != sink::string)
+                {
+                    _buffer.reserve(buffer_size);
+                }
+            }
+
+            // libyaml flushes its own small buffer at every document end; collect
+            // those writes here so that many small documents cost few syscalls
+            static int write(void* ext, unsigned char* buffer, size_t size)
+            {
+                impl* self= static_cast<impl*>(ext);
+
+                try
+                {
+                    self->_output->append(reinterpret_cast<char const*>(buffer), size);
+                    if(self->_sink != sink::string && self->_buffer.size() >= buffer_size)
+                    {
+                        self->drain();
+                    }
+                }
+                catch(...)
+                {
+                    self->_error= std::current_exception();
+                    return 0;
+                }
+
+                return 1;
+            }
+
+            void drain()
+            {
+                switch(_sink)
+                {
+                    case sink::ostream:
+                        _ostream->write(_buffer.data(), _buffer.size());
+                        break;
+                    case sink::fd:
+                        for(std::size_t done= 0; done < _buffer.size(); )
+                        {
+                            ssize_t const n= ::write(_fd, _buffer.data() + done, _buffer.size() - done);
+
+                            if(n < 0)
+                            {
+                                if(errno == EINTR)
+                                {
+                                    continue;
+                                }
+                                throw std::system_error(errno, std::generic_category(), "write");
+                            }
+                            done+= n;
+                        }
+                        break;
+                    case sink::string:
+                        return;
+                }
+                _buffer.clear();
+            }
+
+            // libyaml takes the event over and frees it, whether it succeeds or not
+            void emit(yaml_event_t& event)
+            {
+                if(!yaml_emitter_emit(&_emitter, &event))
+                {
+                    fail();
+                }
+            }
+
+            [[noreturn]] void fail()
+            {
+                if(_error)
+                {
+                    std::exception_ptr error= _error;
+
+                    _error= nullptr;
+                    std::rethrow_exception(error);
+                }
+
+                throw emitter_error(_emitter.problem ? _emitter.problem : "emitter error");
+            }
+
+            // libyaml wants NUL-terminated anchors and tags; copy them into scratch
+            // strings that keep their capacity between events
+            static yaml_char_t* terminate(std::string& scratch, std::string_view s)
+            {
+                if(s.empty())
+                {
+                    return nullptr;
+                }
+
+                scratch.assign(s.data(), s.size());
+
+                return reinterpret_cast<yaml_char_t*>(&scratch[0]);
+            }
+        private:
+            yaml_emitter_t _emitter;
+            sink _sink;
+            std::ostream* _ostream;
+            int _fd;
+            std::string _buffer;
+            std::string* _output;
+            std::string _anchor;
+            std::string _tag;
+            std::exception_ptr _error;
+    };
+
+    emitter::emitter(std::ostream& ostream) : _impl(new impl(ostream))
+    {
+    }
+
+    emitter::emitter(int fd) : _impl(new impl(fd))
+    {
+    }
+
+    emitter::emitter(std::string& buffer) : _impl(new impl(buffer))
+    {
+    }
+
+    emitter::~emitter()= default;
+
+    emitter& emitter::indent(int val)
+    {
+        _impl->indent(val);
+        return *this;
+    }
+
+    emitter& emitter::width(int val)
+    {
+        _impl->width(val);
+        return *this;
+    }
+
+    emitter& emitter::unicode(bool val)
+    {
+        _impl->unicode(val);
+        return *this;
+    }
+
+    emitter& emitter::canonical(bool val)
+    {
+        _impl->canonical(val);
+        return *this;
+    }
+
+    emitter& emitter::emit(event const& e)
+    {
+        switch(e.type())
+        {
+            case event_type::stream_start:
+                return emit(e.get<stream_start_event>());
+            case event_type::stream_end:
+                return emit(e.get<stream_end_event>());
+            case event_type::document_start:
+                return emit(e.get<document_start_event>());
+            case event_type::document_end:
+                return emit(e.get<document_end_event>());
+            case event_type::alias:
+                return emit(e.get<alias_event>());
+            case event_type::scalar:
+                return emit(e.get<scalar_event>());
+            case event_type::sequence_start:
+                return emit(e.get<sequence_start_event>());
+            case event_type::sequence_end:
+                return emit(e.get<sequence_end_event>());
+            case event_type::mapping_start:
+                return emit(e.get<mapping_start_event>());
+            case event_type::mapping_end:
+                return emit(e.get<mapping_end_event>());
+            case event_type::none:
+            default:
+                return *this;
+        }
+    }
+
+    emitter& emitter::emit(stream_start_event const& e)
+    {
+        return stream_start(e.encoding());
+    }
+
+    emitter& emitter::emit(stream_end_event const&)
+    {
+        return stream_end();
+    }
+
+    emitter& emitter::emit(document_start_event const& e)
+    {
+        return document_start(e.implicit(), e.version_major(), e.version_minor());
+    }
+
+    emitter& emitter::emit(document_end_event const& e)
+    {
+        return document_end(e.implicit());
+    }
+
+    emitter& emitter::emit(sequence_end_event const&)
+    {
+        return sequence_end();
+    }
+
+    emitter& emitter::emit(mapping_end_event const&)
+    {
+        return mapping_end();
+    }
+
+    emitter& emitter::stream_start(yamlman::encoding encoding)
+    {
+        _impl->stream_start(encoding);
+        return *this;
+    }
+
+    emitter& emitter::stream_end()
+    {
+        _impl->stream_end();
+        return *this;
+    }
+
+    emitter& emitter::document_start(bool implicit, int version_major, int version_minor)
+    {
+        _impl->document_start(implicit, version_major, version_minor);
+        return *this;
+    }
+
+    emitter& emitter::document_end(bool implicit)
+    {
+        _impl->document_end(implicit);
+        return *this;
+    }
+
+    emitter& emitter::alias(std::string_view anchor)
+    {
+        _impl->alias(anchor);
+        return *this;
+    }
+
+    emitter& emitter::scalar(std::string_view value, scalar_style style, std::string_view anchor, std::string_view tag)
+    {
+        return put_scalar(value, style, anchor, tag, tag.empty(), tag.empty());
+    }
+
+    emitter& emitter::sequence_start(collection_style style, std::string_view anchor, std::string_view tag)
+    {
+        return put_sequence_start(style, anchor, tag, tag.empty());
+    }
+
+    emitter& emitter::sequence_end()
+    {
+        _impl->sequence_end();
+        return *this;
+    }
+
+    emitter& emitter::mapping_start(collection_style style, std::string_view anchor, std::string_view tag)
+    {
+        return put_mapping_start(style, anchor, tag, tag.empty());
+    }
+
+    emitter& emitter::mapping_end()
+    {
+        _impl->mapping_end();
+        return *this;
+    }
+
+    void emitter::flush()
+    {
+        _impl->flush();
+    }
+
+    emitter& emitter::put_scalar(std::string_view value, scalar_style style, std::string_view anchor, std::string_view tag, bool plain_implicit, bool quoted_implicit)
+    {
+        _impl->scalar(value, style, anchor, tag, plain_implicit, quoted_implicit);
+        return *this;
+    }
+
+    emitter& emitter::put_sequence_start(collection_style style, std::string_view anchor, std::string_view tag, bool implicit)
+    {
+        _impl->sequence_start(style, anchor, tag, implicit);
+        return *this;
+    }
+
+    emitter& emitter::put_mapping_start(collection_style style, std::string_view anchor, std::string_view tag, bool implicit)
+    {
+        _impl->mapping_start(style, anchor, tag, implicit);
+        return *this;
+    }
+} // namespace yamlman
@@ -0,0 +1,94 @@
+#ifndef YAMLMAN_EMITTER_H_
+#define YAMLMAN_EMITTER_H_
+
+#include "event.h"
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace yamlman
+{
+    class emitter_error : public std::runtime_error
+    {
+        public:
+            explicit emitter_error(std::string const& what) : std::runtime_error(what){}
+    };
+
+    // writes yaml from the same events the parser produces, or from the builder
+    // calls below; both take the events in stream order, starting with a stream start.
+    // output is collected in a large buffer and only handed to the sink when it
+    // fills up, on flush() and on destruction. throws emitter_error on events out
+    // of order, and std::system_error when writing to a file descriptor fails.
+    class emitter
+    {
+        public:
+            explicit emitter(std::ostream& ostream);
+            // the descriptor stays open; closing it is up to the caller
+            explicit emitter(int fd);
+            // appends to the string, which must outlive the emitter
+            explicit emitter(std::string& buffer);
+            ~emitter();
+            emitter(emitter const&)= delete;
+            emitter& operator = (emitter const&)= delete;
+        public:
+            // output settings; they take effect on the next stream start
+            emitter& indent(int val);
+            emitter& width(int val);
+            emitter& unicode(bool val);
+            emitter& canonical(bool val);
+        public:
+            emitter& emit(event const& e);
+            emitter& emit(stream_start_event const& e);
+            emitter& emit(stream_end_event const& e);
+            emitter& emit(document_start_event const& e);
+            emitter& emit(document_end_event const& e);
+            emitter& emit(sequence_end_event const& e);
+            emitter& emit(mapping_end_event const& e);
+            template<class String>
+            emitter& emit(basic_alias_event<String> const& e)
+            {
+                return alias(e.anchor());
+            }
+            template<class String>
+            emitter& emit(basic_scalar_event<String> const& e)
+            {
+                return put_scalar(e.value(), e.style(), e.anchor(), e.tag(), e.plain_implicit(), e.quoted_implicit());
+            }
+            template<class String>
+            emitter& emit(basic_sequence_start_event<String> const& e)
+            {
+                return put_sequence_start(e.style(), e.anchor(), e.tag(), e.implicit());
+            }
+            template<class String>
+            emitter& emit(basic_mapping_start_event<String> const& e)
+            {
+                return put_mapping_start(e.style(), e.anchor(), e.tag(), e.implicit());
+            }
+        public:
+            // builder; a node without a tag is written with its tag left implicit
+            emitter& stream_start(yamlman::encoding encoding= yamlman::encoding::utf8);
+            emitter& stream_end();
+            // a version of 0.0 writes no %YAML directive
+            emitter& document_start(bool implicit= true, int version_major= 0, int version_minor= 0);
+            emitter& document_end(bool implicit= true);
+            emitter& alias(std::string_view anchor);
+            emitter& scalar(std::string_view value, scalar_style style= scalar_style::any, std::string_view anchor= std::string_view(), std::string_view tag= std::string_view());
+            emitter& sequence_start(collection_style style= collection_style::any, std::string_view anchor= std::string_view(), std::string_view tag= std::string_view());
+            emitter& sequence_end();
+            emitter& mapping_start(collection_style style= collection_style::any, std::string_view anchor= std::string_view(), std::string_view tag= std::string_view());
+            emitter& mapping_end();
+            // hands everything written so far to the sink
+            void flush();
+        private:
+            emitter& put_scalar(std::string_view value, scalar_style style, std::string_view anchor, std::string_view tag, bool plain_implicit, bool quoted_implicit);
+            emitter& put_sequence_start(collection_style style, std::string_view anchor, std::string_view tag, bool implicit);
+            emitter& put_mapping_start(collection_style style, std::string_view anchor, std::string_view tag, bool implicit);
+        private:
+            class impl;
+            std::unique_ptr<impl> _impl;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_EMITTER_H_
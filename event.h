@@ -1,23 +1,181 @@
 #ifndef YAMLMAN_EVENT_H_
 #define YAMLMAN_EVENT_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 
 namespace yamlman
 {
+    enum class encoding
+    {
+        any,
+        utf8,
+        utf16le,
+        utf16be,
+    };
+
+    enum class scalar_style
+    {
+        any,
+        plain,
+        single_quoted,
+        double_quoted,
+        literal,
+        folded,
+    };
+
+    enum class collection_style
+    {
+        any,
+        block,
+        flow,
+    };
+
+    inline std::string_view stringify(encoding val)
+    {
+        switch(val)
+        {
+            case encoding::utf8:
+                return "UTF-8";
+            case encoding::utf16le:
+                return "UTF-16LE";
+            case encoding::utf16be:
+                return "UTF-16BE";
+            case encoding::any:
+                return "Any";
+            default:
+                return "";
+        }
+    }
+
+    inline std::string_view stringify(scalar_style val)
+    {
+        switch(val)
+        {
+            case scalar_style::plain:
+                return "plain";
+            case scalar_style::single_quoted:
+                return "single-quoted";
+            case scalar_style::double_quoted:
+                return "double-quoted";
+            case scalar_style::literal:
+                return "literal";
+            case scalar_style::folded:
+                return "folded";
+            case scalar_style::any:
+                return "any";
+            default:
+                return "";
+        }
+    }
+
+    inline std::string_view stringify(collection_style val)
+    {
+        switch(val)
+        {
+            case collection_style::block:
+                return "block";
+            case collection_style::flow:
+                return "flow";
+            case collection_style::any:
+                return "any";
+            default:
+                return "";
+        }
+    }
+
+    // a position in the input, counted from 0 as libyaml does. index counts
+    // characters; all three are 64-bit, so they stay exact on inputs past 4GB,
+    // a single line of that size included.
     class mark
     {
         public:
-            int line() const{ return _line; }
-            int column() const{ return _column; }
-            int index() const{ return _index; }
-            void line(int val){ _line= val; }
-            void column(int val){ _column= val; }
-            void index(int val){ _index= val; }
+            std::size_t line() const{ return _line; }
+            std::size_t column() const{ return _column; }
+            std::size_t index() const{ return _index; }
+            void line(std::size_t val){ _line= val; }
+            void column(std::size_t val){ _column= val; }
+            void index(std::size_t val){ _index= val; }
+        private:
+            std::uint64_t _index, _line, _column;
+    };
+
+    // how much of each event's marks the parser fills in
+    enum class mark_mode
+    {
+        // line, column and index
+        full,
+        // the index only, with line and column 0; line_index finds them on demand
+        offset,
+        // nothing; the marks are unspecified, and a reused event keeps those
+        // of an earlier one
+        none,
+    };
+
+    enum class error_type
+    {
+        // libyaml ran out of memory
+        memory,
+        // undecodable input, or the input stream failed
+        reader,
+        scanner,
+        parser,
+    };
+
+    // why and where parsing failed, as libyaml reports it. the context is what was
+    // being parsed when the problem was found, and may be empty. reader errors
+    // have no marks, only the byte offset of the problem.
+    class parse_error : public std::runtime_error
+    {
+        public:
+            parse_error(error_type type, std::string const& problem, mark const& problem_mark, std::string const& context, mark const& context_mark, std::size_t offset)
+                : std::runtime_error(describe(type, problem, problem_mark, context, context_mark, offset)), _type(type), _problem(problem), _context(context), _problem_mark(problem_mark), _context_mark(context_mark), _offset(offset)
+            {
+            }
+        public:
+            error_type type() const{ return _type; }
+            std::string const& problem() const{ return _problem; }
+            std::string const& context() const{ return _context; }
+            mark problem_mark() const{ return _problem_mark; }
+            mark context_mark() const{ return _context_mark; }
+            std::size_t offset() const{ return _offset; }
+        private:
+            // lines and columns count from 1 here, as editors show them
+            static std::string describe(error_type type, std::string const& problem, mark const& problem_mark, std::string const& context, mark const& context_mark, std::size_t offset)
+            {
+                std::string res;
+
+                if(type == error_type::reader)
+                {
+                    res= "byte " + std::to_string(offset) + ": ";
+                }
+                else if(type != error_type::memory)
+                {
+                    res= "line " + std::to_string(problem_mark.line() + 1) + " column " + std::to_string(problem_mark.column() + 1) + ": ";
+                }
+                res+= problem;
+                if(!context.empty())
+                {
+                    res+= " (" + context + " at line " + std::to_string(context_mark.line() + 1) + " column " + std::to_string(context_mark.column() + 1) + ")";
+                }
+
+                return res;
+            }
         private:
-            int _line, _column, _index;
+            error_type _type;
+            std::string _problem, _context;
+            mark _problem_mark, _context_mark;
+            std::size_t _offset;
     };
 
+    // a tag or anchor interned in a symbol_table; 0 stands for none
+    typedef std::uint32_t symbol;
+
     class base_event
     {
         public:
@@ -32,10 +190,10 @@ namespace yamlman
     class stream_start_event : public base_event
     {
         public:
-            std::string const& encoding() const{ return _encoding; }
-            void encoding(std::string const& val){ _encoding= val; }
+            yamlman::encoding encoding() const{ return _encoding; }
+            void encoding(yamlman::encoding val){ _encoding= val; }
         private:
-            std::string _encoding;
+            yamlman::encoding _encoding;
     };
 
     class stream_end_event : public base_event
@@ -45,14 +203,15 @@ namespace yamlman
     class document_start_event : public base_event
     {
         public:
-            std::string const& version_directive() const{ return _version_directive; }
-            std::string const& tag_directives() const{ return _tag_directives; }
+            // %YAML directive; both are 0 when the document has none
+            int version_major() const{ return _version_major; }
+            int version_minor() const{ return _version_minor; }
             bool implicit() const{ return _implicit; }
-            void version_directive(std::string const& val){ _version_directive= val; }
-            void tag_directives(std::string const& val){ _tag_directives= val; }
+            void version_major(int val){ _version_major= val; }
+            void version_minor(int val){ _version_minor= val; }
             void implicit(bool val){ _implicit= val; }
         private:
-            std::string _version_directive, _tag_directives;
+            int _version_major, _version_minor;
             bool _implicit;
     };
 
@@ -65,78 +224,284 @@ namespace yamlman
             bool _implicit;
     };
 
-    class alias_event : public base_event
+    // text fields of the view events point into the parser's current libyaml
+    // event and are only valid during the handler call; use to_owned() to keep them.
+    // anchor_id and tag_id come from the parser's symbol_table, and are 0 without one.
+    template<class String>
+    class basic_alias_event : public base_event
     {
         public:
-            std::string const& anchor() const{ return _anchor; }
-            void anchor(std::string const& val){ _anchor= val; }
+            String const& anchor() const{ return _anchor; }
+            symbol anchor_id() const{ return _anchor_id; }
+            void anchor(String const& val){ _anchor= val; }
+            void anchor_id(symbol val){ _anchor_id= val; }
+            basic_alias_event<std::string> to_owned() const
+            {
+                basic_alias_event<std::string> res;
+
+                res.start_mark(start_mark());
+                res.end_mark(end_mark());
+                res.anchor(std::string(_anchor));
+                res.anchor_id(_anchor_id);
+
+                return res;
+            }
         private:
-            std::string _anchor;
+            String _anchor;
+            symbol _anchor_id;
     };
 
-    class scalar_event : public base_event
+    template<class String>
+    class basic_scalar_event : public base_event
     {
         public:
-            std::string const& anchor() const{ return _anchor; }
-            std::string const& tag() const{ return _tag; }
+            String const& anchor() const{ return _anchor; }
+            String const& tag() const{ return _tag; }
+            symbol anchor_id() const{ return _anchor_id; }
+            symbol tag_id() const{ return _tag_id; }
             bool plain_implicit() const{ return _plain_implicit; }
             bool quoted_implicit() const{ return _quotec_implicit; }
-            std::string const& value() const{ return _value; }
-            std::string const& style() const{ return _style; }
-            void anchor(std::string const& val){ _anchor= val; }
-            void tag(std::string const& val){ _tag= val; }
+            String const& value() const{ return _value; }
+            std::size_t length() const{ return _value.size(); }
+            scalar_style style() const{ return _style; }
+            void anchor(String const& val){ _anchor= val; }
+            void tag(String const& val){ _tag= val; }
+            void anchor_id(symbol val){ _anchor_id= val; }
+            void tag_id(symbol val){ _tag_id= val; }
             void plain_implicit(bool val){ _plain_implicit= val; }
             void quoted_implicit(bool val){ _quotec_implicit= val; }
-            void value(std::string const& val){ _value= val; }
-            void style(std::string const& val){ _style= val; }
+            void value(String const& val){ _value= val; }
+            void style(scalar_style val){ _style= val; }
+            basic_scalar_event<std::string> to_owned() const
+            {
+                basic_scalar_event<std::string> res;
+
+                res.start_mark(start_mark());
+                res.end_mark(end_mark());
+                res.anchor(std::string(_anchor));
+                res.tag(std::string(_tag));
+                res.anchor_id(_anchor_id);
+                res.tag_id(_tag_id);
+                res.plain_implicit(_plain_implicit);
+                res.quoted_implicit(_quotec_implicit);
+                res.value(std::string(_value));
+                res.style(_style);
+
+                return res;
+            }
         private:
-            std::string _anchor, _tag;
+            String _anchor, _tag;
+            symbol _anchor_id, _tag_id;
             bool _plain_implicit, _quotec_implicit;
-            std::string _value;
-            std::string _style;
+            String _value;
+            scalar_style _style;
     };
 
-    class sequence_start_event : public base_event
+    template<class String>
+    class basic_sequence_start_event : public base_event
     {
         public:
-            std::string const& anchor() const{ return _anchor; }
-            std::string const& tag() const{ return _tag; }
+            String const& anchor() const{ return _anchor; }
+            String const& tag() const{ return _tag; }
+            symbol anchor_id() const{ return _anchor_id; }
+            symbol tag_id() const{ return _tag_id; }
             bool implicit() const{ return _implicit; }
-            std::string const& style() const{ return _style; }
-            void anchor(std::string const& val){ _anchor= val; }
-            void tag(std::string const& val){ _tag= val; }
+            collection_style style() const{ return _style; }
+            void anchor(String const& val){ _anchor= val; }
+            void tag(String const& val){ _tag= val; }
+            void anchor_id(symbol val){ _anchor_id= val; }
+            void tag_id(symbol val){ _tag_id= val; }
             void implicit(bool val){ _implicit= val; }
-            void style(std::string const& val){ _style= val; }
+            void style(collection_style val){ _style= val; }
+            basic_sequence_start_event<std::string> to_owned() const
+            {
+                basic_sequence_start_event<std::string> res;
+
+                res.start_mark(start_mark());
+                res.end_mark(end_mark());
+                res.anchor(std::string(_anchor));
+                res.tag(std::string(_tag));
+                res.anchor_id(_anchor_id);
+                res.tag_id(_tag_id);
+                res.implicit(_implicit);
+                res.style(_style);
+
+                return res;
+            }
         private:
-            std::string _anchor, _tag;
+            String _anchor, _tag;
+            symbol _anchor_id, _tag_id;
             bool _implicit;
-            std::string _style;
+            collection_style _style;
     };
 
     class sequence_end_event : public base_event
     {
     };
 
-    class mapping_start_event : public base_event
+    template<class String>
+    class basic_mapping_start_event : public base_event
     {
         public:
-            std::string const& anchor() const{ return _anchor; }
-            std::string const& tag() const{ return _tag; }
+            String const& anchor() const{ return _anchor; }
+            String const& tag() const{ return _tag; }
+            symbol anchor_id() const{ return _anchor_id; }
+            symbol tag_id() const{ return _tag_id; }
             bool implicit() const{ return _implicit; }
-            std::string const& style() const{ return _style; }
-            void anchor(std::string const& val){ _anchor= val; }
-            void tag(std::string const& val){ _tag= val; }
+            collection_style style() const{ return _style; }
+            void anchor(String const& val){ _anchor= val; }
+            void tag(String const& val){ _tag= val; }
+            void anchor_id(symbol val){ _anchor_id= val; }
+            void tag_id(symbol val){ _tag_id= val; }
             void implicit(bool val){ _implicit= val; }
-            void style(std::string const& val){ _style= val; }
+            void style(collection_style val){ _style= val; }
+            basic_mapping_start_event<std::string> to_owned() const
+            {
+                basic_mapping_start_event<std::string> res;
+
+                res.start_mark(start_mark());
+                res.end_mark(end_mark());
+                res.anchor(std::string(_anchor));
+                res.tag(std::string(_tag));
+                res.anchor_id(_anchor_id);
+                res.tag_id(_tag_id);
+                res.implicit(_implicit);
+                res.style(_style);
+
+                return res;
+            }
         private:
-            std::string _anchor, _tag;
+            String _anchor, _tag;
+            symbol _anchor_id, _tag_id;
             bool _implicit;
-            std::string _style;
+            collection_style _style;
     };
 
     class mapping_end_event : public base_event
     {
     };
+
+    typedef basic_alias_event<std::string_view>          alias_event;
+    typedef basic_scalar_event<std::string_view>         scalar_event;
+    typedef basic_sequence_start_event<std::string_view> sequence_start_event;
+    typedef basic_mapping_start_event<std::string_view>  mapping_start_event;
+
+    typedef basic_alias_event<std::string>          owned_alias_event;
+    typedef basic_scalar_event<std::string>         owned_scalar_event;
+    typedef basic_sequence_start_event<std::string> owned_sequence_start_event;
+    typedef basic_mapping_start_event<std::string>  owned_mapping_start_event;
+
+    // the view events are plain values; handlers may copy them freely while the views are alive
+    static_assert(std::is_trivially_copyable<stream_start_event>::value, "stream_start_event");
+    static_assert(std::is_trivially_copyable<document_start_event>::value, "document_start_event");
+    static_assert(std::is_trivially_copyable<alias_event>::value, "alias_event");
+    static_assert(std::is_trivially_copyable<scalar_event>::value, "scalar_event");
+    static_assert(std::is_trivially_copyable<sequence_start_event>::value, "sequence_start_event");
+    static_assert(std::is_trivially_copyable<mapping_start_event>::value, "mapping_start_event");
+
+    enum class event_type
+    {
+        none,
+        stream_start,
+        stream_end,
+        document_start,
+        document_end,
+        alias,
+        scalar,
+        sequence_start,
+        sequence_end,
+        mapping_start,
+        mapping_end,
+    };
+
+    // tagged event for the pull api; the parser reuses one instance between steps
+    class event
+    {
+        public:
+            event_type type() const{ return static_cast<event_type>(_value.index()); }
+            template<class Event> Event const& get() const{ return std::get<Event>(_value); }
+            template<class Event> Event& reset()
+            {
+                if(Event* const p= std::get_if<Event>(&_value))
+                {
+                    return *p;
+                }
+                return _value.template emplace<Event>();
+            }
+            // the held event as its base, for its marks; nullptr when empty
+            base_event* base()
+            {
+                return std::visit([](auto& e)->base_event*{
+                    if constexpr(std::is_base_of<base_event, std::decay_t<decltype(e)>>::value)
+                    {
+                        return &e;
+                    }
+                    else
+                    {
+                        return nullptr;
+                    }
+                }, _value);
+            }
+            base_event const* base() const
+            {
+                return const_cast<event*>(this)->base();
+            }
+        private:
+            // alternatives are in event_type order
+            std::variant<
+                std::monostate,
+                stream_start_event,
+                stream_end_event,
+                document_start_event,
+                document_end_event,
+                alias_event,
+                scalar_event,
+                sequence_start_event,
+                sequence_end_event,
+                mapping_start_event,
+                mapping_end_event
+            > _value;
+    };
+
+    // rebinds an event's views to copies made by storage.copy(std::string_view),
+    // e.g. an arena, so the event outlives the parser step it came from
+    template<class Storage>
+    void persist(event& e, Storage& storage)
+    {
+        switch(e.type())
+        {
+            case event_type::alias:{
+                alias_event& ev= e.reset<alias_event>();
+
+                ev.anchor(storage.copy(ev.anchor()));
+                break;
+            }
+            case event_type::scalar:{
+                scalar_event& ev= e.reset<scalar_event>();
+
+                ev.anchor(storage.copy(ev.anchor()));
+                ev.tag(storage.copy(ev.tag()));
+                ev.value(storage.copy(ev.value()));
+                break;
+            }
+            case event_type::sequence_start:{
+                sequence_start_event& ev= e.reset<sequence_start_event>();
+
+                ev.anchor(storage.copy(ev.anchor()));
+                ev.tag(storage.copy(ev.tag()));
+                break;
+            }
+            case event_type::mapping_start:{
+                mapping_start_event& ev= e.reset<mapping_start_event>();
+
+                ev.anchor(storage.copy(ev.anchor()));
+                ev.tag(storage.copy(ev.tag()));
+                break;
+            }
+            default:
+                break;
+        }
+    }
 } // namespace yamlman
 
 #endif
@@ -0,0 +1,250 @@
+#ifndef YAMLMAN_EVENT_GENERATOR_H_
+#define YAMLMAN_EVENT_GENERATOR_H_
+
+// c++20 coroutines over the parser. the library itself is c++17; with an
+// older standard this header declares nothing.
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#include "parser.h"
+#include "arena.h"
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace yamlman
+{
+    // a lazy range of events, for a range-for over events(parser).
+    // each event is valid until the iterator is incremented.
+    class event_generator
+    {
+        public:
+            struct promise_type
+            {
+                event const* current= nullptr;
+                std::exception_ptr error;
+
+                event_generator get_return_object()
+                {
+                    return event_generator(std::coroutine_handle<promise_type>::from_promise(*this));
+                }
+                std::suspend_always initial_suspend() noexcept{ return {}; }
+                std::suspend_always final_suspend() noexcept{ return {}; }
+                std::suspend_always yield_value(event const& e) noexcept
+                {
+                    current= &e;
+                    return {};
+                }
+                void return_void(){}
+                void unhandled_exception(){ error= std::current_exception(); }
+            };
+
+            class iterator
+            {
+                public:
+                    typedef std::input_iterator_tag iterator_category;
+                    typedef event value_type;
+                    typedef std::ptrdiff_t difference_type;
+                    typedef event const* pointer;
+                    typedef event const& reference;
+                public:
+                    iterator() : _handle(nullptr){}
+                    explicit iterator(std::coroutine_handle<promise_type> handle) : _handle(handle){}
+                public:
+                    reference operator * () const{ return *_handle.promise().current; }
+                    pointer operator -> () const{ return _handle.promise().current; }
+                    iterator& operator ++ ()
+                    {
+                        advance(_handle);
+                        return *this;
+                    }
+                    void operator ++ (int){ ++*this; }
+                    bool operator == (std::default_sentinel_t) const{ return !_handle || _handle.done(); }
+                private:
+                    std::coroutine_handle<promise_type> _handle;
+            };
+        public:
+            event_generator(event_generator&& rhs) noexcept : _handle(std::exchange(rhs._handle, nullptr)){}
+            ~event_generator()
+            {
+                if(_handle)
+                {
+                    _handle.destroy();
+                }
+            }
+            event_generator(event_generator const&)= delete;
+            event_generator& operator = (event_generator const&)= delete;
+            event_generator& operator = (event_generator&&)= delete;
+        public:
+            // runs up to the first event; parse errors and handler exceptions
+            // come out of begin() and ++
+            iterator begin()
+            {
+                advance(_handle);
+                return iterator(_handle);
+            }
+            std::default_sentinel_t end() const{ return std::default_sentinel; }
+        private:
+            explicit event_generator(std::coroutine_handle<promise_type> handle) : _handle(handle){}
+
+            static void advance(std::coroutine_handle<promise_type> handle)
+            {
+                handle.resume();
+                if(handle.promise().error)
+                {
+                    std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+                }
+            }
+        private:
+            std::coroutine_handle<promise_type> _handle;
+    };
+
+    // the events parser.next() pulls, without copies. throws the parser's
+    // parse_error when the stream ends in one.
+    inline event_generator events(parser& parser)
+    {
+        while(event const* e= parser.next())
+        {
+            co_yield *e;
+        }
+        if(parse_error const* err= parser.error())
+        {
+            throw *err;
+        }
+    }
+
+    // the events of input that arrives asynchronously, one co_await at a time:
+    //   while(event const* e= co_await gen.next())
+    // the consumer is resumed by whoever resumes the input source, so one thread
+    // can interleave many of these. each event is valid until the next co_await.
+    class async_event_generator
+    {
+        public:
+            struct promise_type
+            {
+                event const* current= nullptr;
+                std::coroutine_handle<> consumer;
+                std::exception_ptr error;
+
+                // hands control straight back to the awaiting consumer
+                struct yield_awaiter
+                {
+                    bool await_ready() noexcept{ return false; }
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept
+                    {
+                        return self.promise().consumer;
+                    }
+                    void await_resume() noexcept{}
+                };
+
+                async_event_generator get_return_object()
+                {
+                    return async_event_generator(std::coroutine_handle<promise_type>::from_promise(*this));
+                }
+                std::suspend_always initial_suspend() noexcept{ return {}; }
+                yield_awaiter final_suspend() noexcept
+                {
+                    current= nullptr;
+                    return {};
+                }
+                yield_awaiter yield_value(event const& e) noexcept
+                {
+                    current= &e;
+                    return {};
+                }
+                void return_void(){}
+                void unhandled_exception(){ error= std::current_exception(); }
+            };
+
+            class next_awaiter
+            {
+                public:
+                    explicit next_awaiter(std::coroutine_handle<promise_type> handle) : _handle(handle){}
+                public:
+                    bool await_ready() const noexcept{ return _handle.done(); }
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept
+                    {
+                        _handle.promise().consumer= consumer;
+                        return _handle;
+                    }
+                    // nullptr at the end of the stream
+                    event const* await_resume()
+                    {
+                        if(_handle.promise().error)
+                        {
+                            std::rethrow_exception(std::exchange(_handle.promise().error, nullptr));
+                        }
+                        return _handle.done() ? nullptr : _handle.promise().current;
+                    }
+                private:
+                    std::coroutine_handle<promise_type> _handle;
+            };
+        public:
+            async_event_generator(async_event_generator&& rhs) noexcept : _handle(std::exchange(rhs._handle, nullptr)){}
+            ~async_event_generator()
+            {
+                if(_handle)
+                {
+                    _handle.destroy();
+                }
+            }
+            async_event_generator(async_event_generator const&)= delete;
+            async_event_generator& operator = (async_event_generator const&)= delete;
+            async_event_generator& operator = (async_event_generator&&)= delete;
+        public:
+            next_awaiter next(){ return next_awaiter(_handle); }
+        private:
+            explicit async_event_generator(std::coroutine_handle<promise_type> handle) : _handle(handle){}
+        private:
+            std::coroutine_handle<promise_type> _handle;
+    };
+
+    // parses what co_await source() returns, a std::string_view per chunk and an
+    // empty one at the end, through its own parser's feed(). setup may select
+    // paths or pick handlers before parsing starts. the events of each chunk are
+    // copied into the frame and yielded one by one; the chunk itself only has to
+    // live until the next co_await source(). throws the parse_error of a malformed input.
+    template<class Source>
+    async_event_generator async_events(Source source, std::function<void(parser&)> setup= nullptr)
+    {
+        parser parser;
+        std::vector<event> events;
+        arena strings;
+
+        parser.on_event([&](event const& e){
+            events.push_back(e);
+            persist(events.back(), strings);
+        });
+        if(setup)
+        {
+            setup(parser);
+        }
+
+        for(bool more= true; more; )
+        {
+            std::string_view const chunk= co_await source();
+
+            more= !chunk.empty();
+
+            bool const ok= more ? parser.feed(chunk) : parser.finish();
+
+            for(event const& e : events)
+            {
+                co_yield e;
+            }
+            events.clear();
+            strings.clear();
+            if(!ok)
+            {
+                throw *parser.error();
+            }
+        }
+    }
+} // namespace yamlman
+
+#endif // c++20 coroutines
+
+#endif // YAMLMAN_EVENT_GENERATOR_H_
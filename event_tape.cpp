@@ -0,0 +1,534 @@
+#include "event_tape.h"
+#include "mapped_file.h"
+#include "line_index.h"
+#include <cstring>
+#include <limits>
+
+namespace yamlman
+{
+    namespace
+    {
+        char const magic[8]= {'y', 'a', 'm', 'l', 't', 'a', 'p', 'e'};
+        std::uint32_t const version= 4;
+
+        struct header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t record_size;
+            std::uint64_t source_hash;
+            std::uint64_t count;
+            std::uint64_t pool_size;
+        };
+
+        // an event's anchor, tag and value are adjacent in the pool, from offset on.
+        // marks are character indices only; line and column would take half the
+        // record, and a line_index over the source finds them again.
+        struct record
+        {
+            std::uint8_t type;
+            // scalar_style, collection_style or encoding
+            std::uint8_t style;
+            std::uint8_t flags;
+            std::uint8_t version_major, version_minor;
+            std::uint64_t start_index, end_index;
+            std::uint64_t anchor_length, tag_length, value_length;
+            std::uint64_t offset;
+        };
+
+        // a record as it's stored: its numbers are 32 bits wide while they all
+        // fit, the usual case, and 64 bits once any of them doesn't
+        template<class Int>
+        struct packed
+        {
+            std::uint8_t type;
+            std::uint8_t style;
+            std::uint8_t flags;
+            std::uint8_t version_major, version_minor;
+            std::uint8_t pad[3];
+            Int start_index, end_index;
+            Int anchor_length, tag_length, value_length;
+            Int offset;
+        };
+
+        typedef packed<std::uint32_t> narrow;
+        typedef packed<std::uint64_t> wide;
+
+        template<class Int>
+        packed<Int> pack(record const& r)
+        {
+            packed<Int> p= packed<Int>();
+
+            p.type= r.type;
+            p.style= r.style;
+            p.flags= r.flags;
+            p.version_major= r.version_major;
+            p.version_minor= r.version_minor;
+            p.start_index= static_cast<Int>(r.start_index);
+            p.end_index= static_cast<Int>(r.end_index);
+            p.anchor_length= static_cast<Int>(r.anchor_length);
+            p.tag_length= static_cast<Int>(r.tag_length);
+            p.value_length= static_cast<Int>(r.value_length);
+            p.offset= static_cast<Int>(r.offset);
+
+            return p;
+        }
+
+        // records may sit at any alignment in the caller's memory
+        template<class Int>
+        packed<Int> load(char const* data)
+        {
+            packed<Int> p;
+
+            std::memcpy(&p, data, sizeof(p));
+
+            return p;
+        }
+
+        // widened, for the writer; the reader works on the stored width
+        template<class Int>
+        record unpack(char const* data)
+        {
+            packed<Int> const p= load<Int>(data);
+            record r;
+
+            r.type= p.type;
+            r.style= p.style;
+            r.flags= p.flags;
+            r.version_major= p.version_major;
+            r.version_minor= p.version_minor;
+            r.start_index= p.start_index;
+            r.end_index= p.end_index;
+            r.anchor_length= p.anchor_length;
+            r.tag_length= p.tag_length;
+            r.value_length= p.value_length;
+            r.offset= p.offset;
+
+            return r;
+        }
+
+        bool fits_narrow(record const& r)
+        {
+            std::uint64_t const max= std::numeric_limits<std::uint32_t>::max();
+
+            return r.start_index <= max && r.end_index <= max && r.anchor_length <= max && r.tag_length <= max && r.value_length <= max && r.offset <= max;
+        }
+
+        enum : std::uint8_t
+        {
+            implicit= 1,
+            plain_implicit= 2,
+            quoted_implicit= 4,
+        };
+
+        void put_marks(record& r, base_event const& e)
+        {
+            r.start_index= e.start_mark().index();
+            r.end_index= e.end_mark().index();
+        }
+
+        mark locate(std::uint64_t index, line_index const* lines)
+        {
+            if(lines)
+            {
+                return lines->locate(index);
+            }
+
+            mark m;
+
+            m.line(0);
+            m.column(0);
+            m.index(index);
+
+            return m;
+        }
+
+        // get() casts the style byte to the event's enum, and views the pool
+        template<class Int>
+        void check_records(char const* records, std::size_t count, std::uint64_t pool_size)
+        {
+            for(std::size_t i= 0; i < count; ++i)
+            {
+                packed<Int> const r= load<Int>(records + i * sizeof(packed<Int>));
+
+                if(r.type > static_cast<std::uint8_t>(event_type::mapping_end))
+                {
+                    throw tape_error("yamlman: the tape has an unknown event kind");
+                }
+                if(r.offset > pool_size)
+                {
+                    throw tape_error("yamlman: the tape has a string outside its pool");
+                }
+
+                // one length at a time against what is left, so that nothing can wrap
+                std::uint64_t const room= pool_size - r.offset;
+
+                if(r.anchor_length > room || r.tag_length > room - r.anchor_length || r.value_length > room - r.anchor_length - r.tag_length)
+                {
+                    throw tape_error("yamlman: the tape has a string outside its pool");
+                }
+
+                std::uint8_t styles;
+
+                switch(static_cast<event_type>(r.type))
+                {
+                    case event_type::stream_start:
+                        styles= static_cast<std::uint8_t>(encoding::utf16be) + 1;
+                        break;
+                    case event_type::scalar:
+                        styles= static_cast<std::uint8_t>(scalar_style::folded) + 1;
+                        break;
+                    case event_type::sequence_start:
+                    case event_type::mapping_start:
+                        styles= static_cast<std::uint8_t>(collection_style::flow) + 1;
+                        break;
+                    default:
+                        styles= 1;
+                        break;
+                }
+                if(r.style >= styles)
+                {
+                    throw tape_error("yamlman: the tape has an unknown style");
+                }
+            }
+        }
+
+        template<class Int>
+        void get_marks(packed<Int> const& r, base_event& e, line_index const* lines)
+        {
+            e.start_mark(locate(r.start_index, lines));
+            e.end_mark(locate(r.end_index, lines));
+        }
+
+        template<class Int>
+        void decode(packed<Int> const& r, char const* pool, line_index const* lines, event& e)
+        {
+            char const* const strings= pool + r.offset;
+            std::string_view const anchor(strings, r.anchor_length);
+            std::string_view const tag(strings + r.anchor_length, r.tag_length);
+            std::string_view const value(strings + r.anchor_length + r.tag_length, r.value_length);
+
+            switch(static_cast<event_type>(r.type))
+            {
+                case event_type::stream_start:{
+                    stream_start_event& ev= e.reset<stream_start_event>();
+
+                    get_marks(r, ev, lines);
+                    ev.encoding(static_cast<encoding>(r.style));
+                    break;
+                }
+                case event_type::stream_end:
+                    get_marks(r, e.reset<stream_end_event>(), lines);
+                    break;
+                case event_type::document_start:{
+                    document_start_event& ev= e.reset<document_start_event>();
+
+                    get_marks(r, ev, lines);
+                    ev.version_major(r.version_major);
+                    ev.version_minor(r.version_minor);
+                    ev.implicit(r.flags & implicit);
+                    break;
+                }
+                case event_type::document_end:{
+                    document_end_event& ev= e.reset<document_end_event>();
+
+                    get_marks(r, ev, lines);
+                    ev.implicit(r.flags & implicit);
+                    break;
+                }
+                case event_type::alias:{
+                    alias_event& ev= e.reset<alias_event>();
+
+                    get_marks(r, ev, lines);
+                    ev.anchor(anchor);
+                    ev.anchor_id(0);
+                    break;
+                }
+                case event_type::scalar:{
+                    scalar_event& ev= e.reset<scalar_event>();
+
+                    get_marks(r, ev, lines);
+                    ev.anchor(anchor);
+                    ev.tag(tag);
+                    ev.anchor_id(0);
+                    ev.tag_id(0);
+                    ev.value(value);
+                    ev.style(static_cast<scalar_style>(r.style));
+                    ev.plain_implicit(r.flags & plain_implicit);
+                    ev.quoted_implicit(r.flags & quoted_implicit);
+                    break;
+                }
+                case event_type::sequence_start:{
+                    sequence_start_event& ev= e.reset<sequence_start_event>();
+
+                    get_marks(r, ev, lines);
+                    ev.anchor(anchor);
+                    ev.tag(tag);
+                    ev.anchor_id(0);
+                    ev.tag_id(0);
+                    ev.style(static_cast<collection_style>(r.style));
+                    ev.implicit(r.flags & implicit);
+                    break;
+                }
+                case event_type::sequence_end:
+                    get_marks(r, e.reset<sequence_end_event>(), lines);
+                    break;
+                case event_type::mapping_start:{
+                    mapping_start_event& ev= e.reset<mapping_start_event>();
+
+                    get_marks(r, ev, lines);
+                    ev.anchor(anchor);
+                    ev.tag(tag);
+                    ev.anchor_id(0);
+                    ev.tag_id(0);
+                    ev.style(static_cast<collection_style>(r.style));
+                    ev.implicit(r.flags & implicit);
+                    break;
+                }
+                case event_type::mapping_end:
+                    get_marks(r, e.reset<mapping_end_event>(), lines);
+                    break;
+                case event_type::none:
+                default:
+                    e= event();
+                    break;
+            }
+        }
+    } // namespace
+
+    std::uint64_t source_hash(char const* data, std::size_t size)
+    {
+        std::uint64_t const k= 0x9E3779B97F4A7C15ull;
+        std::uint64_t h= size * k;
+        std::size_t i= 0;
+
+        for(; i + 8 <= size; i+= 8)
+        {
+            std::uint64_t w;
+
+            std::memcpy(&w, data + i, 8);
+            h= (h ^ w) * k;
+            h^= h >> 29;
+        }
+        for(; i < size; ++i)
+        {
+            h= (h ^ static_cast<unsigned char>(data[i])) * k;
+        }
+        h^= h >> 32;
+
+        return h;
+    }
+
+    tape_writer::tape_writer() : _count(0), _wide(false)
+    {
+    }
+
+    void tape_writer::add(event const& e)
+    {
+        record r= record();
+        std::string_view anchor, tag, value;
+
+        r.type= static_cast<std::uint8_t>(e.type());
+        r.offset= _pool.size();
+        if(base_event const* const base= e.base())
+        {
+            put_marks(r, *base);
+        }
+        switch(e.type())
+        {
+            case event_type::stream_start:
+                r.style= static_cast<std::uint8_t>(e.get<stream_start_event>().encoding());
+                break;
+            case event_type::document_start:{
+                document_start_event const& ev= e.get<document_start_event>();
+
+                r.version_major= static_cast<std::uint8_t>(ev.version_major());
+                r.version_minor= static_cast<std::uint8_t>(ev.version_minor());
+                r.flags= ev.implicit() ? implicit : 0;
+                break;
+            }
+            case event_type::document_end:
+                r.flags= e.get<document_end_event>().implicit() ? implicit : 0;
+                break;
+            case event_type::alias:
+                anchor= e.get<alias_event>().anchor();
+                break;
+            case event_type::scalar:{
+                scalar_event const& ev= e.get<scalar_event>();
+
+                anchor= ev.anchor();
+                tag= ev.tag();
+                value= ev.value();
+                r.style= static_cast<std::uint8_t>(ev.style());
+                r.flags= (ev.plain_implicit() ? plain_implicit : 0) | (ev.quoted_implicit() ? quoted_implicit : 0);
+                break;
+            }
+            case event_type::sequence_start:{
+                sequence_start_event const& ev= e.get<sequence_start_event>();
+
+                anchor= ev.anchor();
+                tag= ev.tag();
+                r.style= static_cast<std::uint8_t>(ev.style());
+                r.flags= ev.implicit() ? implicit : 0;
+                break;
+            }
+            case event_type::mapping_start:{
+                mapping_start_event const& ev= e.get<mapping_start_event>();
+
+                anchor= ev.anchor();
+                tag= ev.tag();
+                r.style= static_cast<std::uint8_t>(ev.style());
+                r.flags= ev.implicit() ? implicit : 0;
+                break;
+            }
+            default:
+                break;
+        }
+
+        r.anchor_length= anchor.size();
+        r.tag_length= tag.size();
+        r.value_length= value.size();
+        _pool.append(anchor).append(tag).append(value);
+        if(!_wide && !fits_narrow(r))
+        {
+            widen();
+        }
+        if(_wide)
+        {
+            wide const p= pack<std::uint64_t>(r);
+
+            _records.append(reinterpret_cast<char const*>(&p), sizeof(p));
+        }
+        else
+        {
+            narrow const p= pack<std::uint32_t>(r);
+
+            _records.append(reinterpret_cast<char const*>(&p), sizeof(p));
+        }
+        ++_count;
+    }
+
+    // a source or pool past 4 GiB; what was recorded so far is copied over once
+    void tape_writer::widen()
+    {
+        std::string records;
+
+        records.reserve(_count * sizeof(wide));
+        for(std::size_t i= 0; i < _count; ++i)
+        {
+            wide const p= pack<std::uint64_t>(unpack<std::uint32_t>(_records.data() + i * sizeof(narrow)));
+
+            records.append(reinterpret_cast<char const*>(&p), sizeof(p));
+        }
+        _records.swap(records);
+        _wide= true;
+    }
+
+    void tape_writer::write(std::ostream& ostream, std::uint64_t source_hash) const
+    {
+        header h;
+
+        std::memcpy(h.magic, magic, sizeof(magic));
+        h.version= version;
+        h.record_size= _wide ? sizeof(wide) : sizeof(narrow);
+        h.source_hash= source_hash;
+        h.count= _count;
+        h.pool_size= _pool.size();
+
+        ostream.write(reinterpret_cast<char const*>(&h), sizeof(h));
+        ostream.write(_records.data(), _records.size());
+        ostream.write(_pool.data(), _pool.size());
+        ostream.flush();
+        if(!ostream)
+        {
+            throw tape_error("yamlman: failed to write the tape");
+        }
+    }
+
+    void tape_writer::clear()
+    {
+        _records.clear();
+        _pool.clear();
+        _count= 0;
+        _wide= false;
+    }
+
+    tape_reader::tape_reader(char const* data, std::size_t size) : _lines(nullptr)
+    {
+        header h;
+
+        if(size < sizeof(h))
+        {
+            throw tape_error("yamlman: not a tape");
+        }
+        std::memcpy(&h, data, sizeof(h));
+        if(std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+        {
+            throw tape_error("yamlman: not a tape");
+        }
+        if(h.version != version || (h.record_size != sizeof(narrow) && h.record_size != sizeof(wide)))
+        {
+            throw tape_error("yamlman: the tape is of another version or machine");
+        }
+
+        std::uint64_t const body= size - sizeof(h);
+
+        if(h.count > body / h.record_size || h.pool_size != body - h.count * h.record_size)
+        {
+            throw tape_error("yamlman: the tape is truncated");
+        }
+
+        _records= data + sizeof(h);
+        _record_size= h.record_size;
+        _count= h.count;
+        _pool= _records + _count * _record_size;
+        _pool_size= h.pool_size;
+        _source_hash= h.source_hash;
+        check();
+    }
+
+    tape_reader::tape_reader(mapped_file const& file) : tape_reader(file.data(), file.size())
+    {
+    }
+
+    bool tape_reader::valid_for(char const* data, std::size_t size) const
+    {
+        return yamlman::source_hash(data, size) == _source_hash;
+    }
+
+    event_type tape_reader::type(std::size_t i) const
+    {
+        std::uint8_t type;
+
+        std::memcpy(&type, _records + i * _record_size + offsetof(narrow, type), 1);
+
+        return static_cast<event_type>(type);
+    }
+
+    void tape_reader::get(std::size_t i, event& e) const
+    {
+        char const* const p= _records + i * _record_size;
+
+        if(_record_size == sizeof(narrow))
+        {
+            decode(load<std::uint32_t>(p), _pool, _lines, e);
+        }
+        else
+        {
+            decode(load<std::uint64_t>(p), _pool, _lines, e);
+        }
+    }
+
+    // one pass up front, so that get() can trust every record
+    void tape_reader::check() const
+    {
+        if(_record_size == sizeof(narrow))
+        {
+            check_records<std::uint32_t>(_records, _count, _pool_size);
+        }
+        else
+        {
+            check_records<std::uint64_t>(_records, _count, _pool_size);
+        }
+    }
+} // namespace yamlman
@@ -0,0 +1,89 @@
+#ifndef YAMLMAN_EVENT_TAPE_H_
+#define YAMLMAN_EVENT_TAPE_H_
+
+#include "event.h"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace yamlman
+{
+    class mapped_file;
+    class line_index;
+
+    class tape_error : public std::runtime_error
+    {
+        public:
+            explicit tape_error(std::string const& what) : std::runtime_error(what){}
+    };
+
+    // hash of a source text that a tape is recorded from; a tape is stale once
+    // its source hashes differently. fast, not cryptographic.
+    std::uint64_t source_hash(char const* data, std::size_t size);
+
+    // records events into a tape: a header, one fixed-size record per event with
+    // its kind, styles, flags and the character indices of its marks, and a pool
+    // with the events' strings. records take 32 bytes while the source and the
+    // pool stay under 4 GiB, 56 past that.
+    // the tape is in this machine's byte order, as a cache for it.
+    //   parser.on_event([&](event const& e){ writer.add(e); }).parse();
+    //   writer.write(out, source_hash(data, size));
+    class tape_writer
+    {
+        public:
+            tape_writer();
+        public:
+            // events in stream order
+            void add(event const& e);
+            // throws tape_error when the stream fails
+            void write(std::ostream& ostream, std::uint64_t source_hash) const;
+            std::size_t size() const{ return _count; }
+            void clear();
+        private:
+            void widen();
+        private:
+            std::string _records;
+            std::string _pool;
+            std::size_t _count;
+            bool _wide;
+    };
+
+    // reads a tape in place; the events it hands out view its memory, which must
+    // outlive them. parser::reset(tape_reader const&) replays one through the
+    // parser's handlers. throws tape_error on a tape that isn't one or is damaged.
+    // marks come back with their index only, as with mark_mode::offset, unless
+    // the reader is given a line_index over the source.
+    class tape_reader
+    {
+        public:
+            tape_reader(char const* data, std::size_t size);
+            explicit tape_reader(mapped_file const& file);
+        public:
+            std::uint64_t source_hash() const{ return _source_hash; }
+            // whether the tape was recorded from this very source
+            bool valid_for(char const* data, std::size_t size) const;
+            // fills in line and column of the marks get() hands out, from now on;
+            // lines must outlive its use, nullptr detaches it
+            tape_reader& lines(line_index const* val){ _lines= val; return *this; }
+            line_index const* lines() const{ return _lines; }
+            // events on the tape
+            std::size_t size() const{ return _count; }
+            event_type type(std::size_t i) const;
+            // the i-th event, with views into the tape
+            void get(std::size_t i, event& e) const;
+        private:
+            void check() const;
+        private:
+            char const* _records;
+            char const* _pool;
+            std::size_t _record_size;
+            std::size_t _count;
+            std::uint64_t _pool_size;
+            std::uint64_t _source_hash;
+            line_index const* _lines;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_EVENT_TAPE_H_
@@ -0,0 +1,70 @@
+#include "fiber.h"
+#include <cstdint>
+#include <system_error>
+#include <cerrno>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace yamlman
+{
+    fiber::fiber(std::function<void()> const& body, std::size_t stack_size) : _body(body), _mapping(nullptr), _mapping_size(0), _done(false)
+    {
+        std::size_t const page= ::sysconf(_SC_PAGESIZE);
+
+        stack_size= (stack_size + page - 1) / page * page;
+
+        void* const p= ::mmap(nullptr, page + stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if(p == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category(), "yamlman: fiber stack");
+        }
+        _mapping= static_cast<char*>(p);
+        _mapping_size= page + stack_size;
+        // stacks grow down, towards the guard
+        if(::mprotect(_mapping, page, PROT_NONE) != 0 || getcontext(&_self) != 0)
+        {
+            int const err= errno;
+
+            ::munmap(_mapping, _mapping_size);
+            throw std::system_error(err, std::generic_category(), "yamlman: fiber stack");
+        }
+        _self.uc_stack.ss_sp= _mapping + page;
+        _self.uc_stack.ss_size= stack_size;
+        _self.uc_link= &_caller;
+
+        // makecontext passes ints only; the pointer goes in two halves
+        std::uintptr_t const self= reinterpret_cast<std::uintptr_t>(this);
+
+        makecontext(&_self, reinterpret_cast<void (*)()>(&fiber::trampoline), 2, static_cast<unsigned>(static_cast<std::uint64_t>(self) >> 32), static_cast<unsigned>(self));
+    }
+
+    fiber::~fiber()
+    {
+        ::munmap(_mapping, _mapping_size);
+    }
+
+    bool fiber::resume()
+    {
+        if(!_done)
+        {
+            swapcontext(&_caller, &_self);
+        }
+
+        return !_done;
+    }
+
+    void fiber::suspend()
+    {
+        swapcontext(&_self, &_caller);
+    }
+
+    void fiber::trampoline(unsigned hi, unsigned lo)
+    {
+        fiber* const self= reinterpret_cast<fiber*>(static_cast<std::uintptr_t>((static_cast<std::uint64_t>(hi) << 32) | lo));
+
+        self->_body();
+        // uc_link returns to the last resume()
+        self->_done= true;
+    }
+} // namespace yamlman
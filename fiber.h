@@ -0,0 +1,43 @@
+#ifndef YAMLMAN_FIBER_H_
+#define YAMLMAN_FIBER_H_
+
+#include <cstddef>
+#include <functional>
+#include <ucontext.h>
+
+namespace yamlman
+{
+    // runs a function on a stack of its own, so that it can stop halfway and
+    // be picked up again later on the same thread. the body must not throw, and
+    // a fiber destroyed while suspended leaves the body's locals undestroyed.
+    // the stack is mapped with a guard page below it, so that running off its
+    // end faults rather than writing over the heap; its pages are only taken
+    // from the system as they are touched. each switch costs a system call,
+    // as swapcontext saves and restores the signal mask.
+    class fiber
+    {
+        public:
+            // throws std::system_error when the stack can't be mapped
+            explicit fiber(std::function<void()> const& body, std::size_t stack_size= 64 * 1024);
+            ~fiber();
+            fiber(fiber const&)= delete;
+            fiber& operator = (fiber const&)= delete;
+        public:
+            // runs the body until it suspends or returns; false once it has returned
+            bool resume();
+            // from inside the body: goes back to the caller of resume()
+            void suspend();
+            bool done() const{ return _done; }
+        private:
+            static void trampoline(unsigned hi, unsigned lo);
+        private:
+            std::function<void()> _body;
+            // the guard page and the stack above it
+            char* _mapping;
+            std::size_t _mapping_size;
+            ucontext_t _caller, _self;
+            bool _done;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_FIBER_H_
@@ -0,0 +1,459 @@
+#ifndef YAMLMAN_LIBYAML_H_
+#define YAMLMAN_LIBYAML_H_
+
+#include "event.h"
+#include <yaml.h>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <iostream>
+
+// glue between libyaml and the yamlman event classes, shared by parser and basic_parser
+namespace yamlman
+{
+    typedef std::function<void(yaml_parser_t*)> yaml_parser_deleter_t;
+    typedef std::unique_ptr<yaml_parser_t, yaml_parser_deleter_t> lp_parser_t;
+
+    inline lp_parser_t make_parser()
+    {
+        lp_parser_t parser(new yaml_parser_t, [](yaml_parser_t* p){
+            if(p)
+            {
+                yaml_parser_delete(p);
+                delete p;
+            }
+        });
+
+        yaml_parser_initialize(parser.get());
+
+        return parser;
+    }
+
+    inline void set_input(yaml_parser_t* parser, std::istream& istream)
+    {
+        yaml_parser_set_input(
+            parser,
+            [](void* ext, unsigned char* buffer, size_t size, size_t* size_read)->int{
+                std::istream* istream= static_cast<std::istream*>(ext);
+                std::istream& read= istream->read(reinterpret_cast<char*>(buffer), size);
+
+                *size_read= read.gcount();
+
+                // error:   0
+                // eof: (size_read, ret) = (0, 1)
+                // success: 1
+                // eof sets failbit as well; only badbit is a failed read
+                return read.bad() ? 0 : 1;
+            },
+            &istream
+        );
+    }
+
+    // libyaml reads the caller's memory in place; it must outlive the parser
+    inline void set_input(yaml_parser_t* parser, char const* data, std::size_t size)
+    {
+        // libyaml asserts on a NULL buffer, which an empty string_view may have
+        yaml_parser_set_input_string(parser, reinterpret_cast<unsigned char const*>(data ? data : ""), size);
+    }
+
+    inline lp_parser_t make_parser(std::istream& istream)
+    {
+        lp_parser_t parser(make_parser());
+
+        set_input(parser.get(), istream);
+
+        return parser;
+    }
+
+    inline lp_parser_t make_parser(char const* data, std::size_t size)
+    {
+        lp_parser_t parser(make_parser());
+
+        set_input(parser.get(), data, size);
+
+        return parser;
+    }
+
+    // rewinds a parser for a new input; libyaml has no reset of its own, so
+    // this reinitializes the state in the same yaml_parser_t
+    inline void reset_parser(yaml_parser_t* parser)
+    {
+        yaml_parser_delete(parser);
+        yaml_parser_initialize(parser);
+    }
+
+    // views into the libyaml event; they stay valid until the event is deleted
+    inline std::string_view const convert(yaml_char_t const* s)
+    {
+        if(!s)
+        {
+            return std::string_view();
+        }
+
+        return std::string_view(reinterpret_cast<char const*>(s));
+    }
+
+    // scalar values may contain NUL characters; trust the length libyaml reports
+    inline std::string_view const convert(yaml_char_t const* s, size_t length)
+    {
+        if(!s)
+        {
+            return std::string_view();
+        }
+
+        return std::string_view(reinterpret_cast<char const*>(s), length);
+    }
+
+    // yaml_event_type_t enumerates the events in the same order as event_type
+    inline event_type to_event_type(yaml_event_type_t type)
+    {
+        static_assert(static_cast<int>(event_type::stream_start) == YAML_STREAM_START_EVENT, "event_type order");
+        static_assert(static_cast<int>(event_type::mapping_end) == YAML_MAPPING_END_EVENT, "event_type order");
+
+        return static_cast<event_type>(type);
+    }
+
+    // Stylistic Event Attributes on any event
+    // start_mark - the position of the event beginning; attributes: index (in characters), line and column (starting from 0).
+    // end_mark   - the position of the event end; attributes: index (in characters), line and column (starting from 0).
+    inline mark make_mark(yaml_mark_t const& m)
+    {
+        mark res;
+
+        res.line(m.line);
+        res.column(m.column);
+        res.index(m.index);
+
+        return res;
+    }
+
+    // libyaml's mark index counts characters, not bytes
+    inline std::size_t characters(char const* first, char const* last)
+    {
+        std::size_t n= 0;
+
+        for(; first != last; ++first)
+        {
+            n+= (static_cast<unsigned char>(*first) & 0xC0) != 0x80;
+        }
+
+        return n;
+    }
+
+    // bytes of the line break at p, 0 when there is none. libyaml breaks lines at
+    // \n, \r\n, \r, U+0085, U+2028 and U+2029
+    inline std::size_t line_break(char const* p, char const* last)
+    {
+        unsigned char const* const u= reinterpret_cast<unsigned char const*>(p);
+        std::size_t const rest= last - p;
+
+        switch(u[0])
+        {
+            case '\n':
+                return 1;
+            case '\r':
+                return rest > 1 && u[1] == '\n' ? 2 : 1;
+            case 0xC2:
+                return rest > 1 && u[1] == 0x85 ? 2 : 0;
+            case 0xE2:
+                return rest > 2 && u[1] == 0x80 && (u[2] == 0xA8 || u[2] == 0xA9) ? 3 : 0;
+            default:
+                return 0;
+        }
+    }
+
+    inline std::size_t line_breaks(char const* first, char const* last)
+    {
+        std::size_t n= 0;
+
+        while(first != last)
+        {
+            std::size_t const length= line_break(first, last);
+
+            n+= length != 0;
+            first+= length ? length : 1;
+        }
+
+        return n;
+    }
+
+    // libyaml reads past a utf-8 byte order mark and counts from after it
+    inline bool has_bom(char const* data, std::size_t size)
+    {
+        return size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0;
+    }
+
+    // the parser's error after yaml_parser_parse failed
+    inline parse_error make_error(yaml_parser_t const& parser)
+    {
+        error_type type;
+
+        switch(parser.error)
+        {
+            case YAML_READER_ERROR:
+                type= error_type::reader;
+                break;
+            case YAML_SCANNER_ERROR:
+                type= error_type::scanner;
+                break;
+            case YAML_PARSER_ERROR:
+                type= error_type::parser;
+                break;
+            case YAML_MEMORY_ERROR:
+            default:
+                type= error_type::memory;
+                break;
+        }
+
+        return parse_error(
+            type,
+            parser.problem ? parser.problem : "out of memory",
+            type == error_type::scanner || type == error_type::parser ? make_mark(parser.problem_mark) : mark(),
+            parser.context ? parser.context : "",
+            parser.context ? make_mark(parser.context_mark) : mark(),
+            parser.problem_offset
+        );
+    }
+
+    template<class Event>
+    void fill_marks(yaml_event_t const& event, Event& e, mark_mode marks)
+    {
+        switch(marks)
+        {
+            case mark_mode::full:
+                e.start_mark(make_mark(event.start_mark));
+                e.end_mark(make_mark(event.end_mark));
+                break;
+            case mark_mode::offset:{
+                mark m= mark();
+
+                m.index(event.start_mark.index);
+                e.start_mark(m);
+                m.index(event.end_mark.index);
+                e.end_mark(m);
+                break;
+            }
+            case mark_mode::none:
+            default:
+                break;
+        }
+    }
+
+    // Stylistic Event Attributes
+    // encoding - the document encoding; utf-8|utf-16-le|utf-16-be. 
+    inline void fill(yaml_event_t const& event, stream_start_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+        switch(event.data.stream_start.encoding)
+        {
+            case YAML_UTF8_ENCODING:
+                e.encoding(encoding::utf8);
+                break;
+            case YAML_UTF16LE_ENCODING:
+                e.encoding(encoding::utf16le);
+                break;
+            case YAML_UTF16BE_ENCODING:
+                e.encoding(encoding::utf16be);
+                break;
+            case YAML_ANY_ENCODING:
+            default:
+                e.encoding(encoding::any);
+                break;
+        }
+    }
+
+    inline void fill(yaml_event_t const& event, stream_end_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+    }
+
+    // Stylistic Event Attributes
+    // version_directive - the version specified with the %YAML directive; the only valid value is 1.1; may be NULL.
+    // tag_directives    - a set of tag handles and the corresponding tag prefixes specified with the %TAG directive; tag handles should match !|!!|![0-9a-zA-Z_-]+! while tag prefixes should be prefixes of valid local or global tags; may be empty.
+    // implicit          - True if the document start indicator --- is not present.
+    inline void fill(yaml_event_t const& event, document_start_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+        {
+            yaml_version_directive_t const* const vd= event.data.document_start.version_directive;
+
+            e.version_major(vd ? vd->major : 0);
+            e.version_minor(vd ? vd->minor : 0);
+        }
+        e.implicit(event.data.document_start.implicit);
+    }
+
+    // Stylistic Event Attributes
+    // implicit - True if the document end indicator ... is not present. 
+    inline void fill(yaml_event_t const& event, document_end_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+        e.implicit(event.data.document_end.implicit);
+    }
+
+    // Essential Event Attributes
+    // anchor - the alias anchor; [0-9a-zA-Z_-]+; not null.
+    inline void fill(yaml_event_t const& event, alias_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+        e.anchor(convert(event.data.alias.anchor));
+        e.anchor_id(0);
+    }
+
+    // Essential Event Attributes
+    // anchor          - the node anchor; [0-9a-zA-Z_-]+; may be NULL.
+    // tag             - the node tag; should either start with ! (local tag) or be a valid URL (global tag); may be NULL or ! in which case either plain_implicit or quoted_implicit should be True.
+    // plain_implicit  - True if the node tag may be omitted whenever the scalar value is presented in the plain style.
+    // quoted_implicit - True if the node tag may be omitted whenever the scalar value is presented in any non-plain style.
+    // value           - the scalar value; a valid utf-8 sequence and may contain NUL characters; not NULL.
+    // length          - the length of the scalar value.
+    //
+    // Stylistic Event Attributes
+    // style - the value style; plain|single-quoted|double-quoted|literal|folded.
+    inline void fill(yaml_event_t const& event, scalar_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+        e.anchor(convert(event.data.scalar.anchor));
+        e.tag(convert(event.data.scalar.tag));
+        e.anchor_id(0);
+        e.tag_id(0);
+        e.plain_implicit(event.data.scalar.plain_implicit);
+        e.quoted_implicit(event.data.scalar.quoted_implicit);
+        e.value(convert(event.data.scalar.value, event.data.scalar.length));
+        switch(event.data.scalar.style)
+        {
+            case YAML_PLAIN_SCALAR_STYLE:
+                e.style(scalar_style::plain);
+                break;
+            case YAML_SINGLE_QUOTED_SCALAR_STYLE:
+                e.style(scalar_style::single_quoted);
+                break;
+            case YAML_DOUBLE_QUOTED_SCALAR_STYLE:
+                e.style(scalar_style::double_quoted);
+                break;
+            case YAML_LITERAL_SCALAR_STYLE:
+                e.style(scalar_style::literal);
+                break;
+            case YAML_FOLDED_SCALAR_STYLE:
+                e.style(scalar_style::folded);
+                break;
+            case YAML_ANY_SCALAR_STYLE:
+            default:
+                e.style(scalar_style::any);
+                break;
+        }
+    }
+
+    // Essential Event Attributes
+    // anchor   - the node anchor; [0-9a-zA-Z_-]+; may be NULL.
+    // tag      - the node tag; should either start with ! (local tag) or be a valid URL (global tag); may be NULL or ! in which case implicit should be True.
+    // implicit - True if the node tag may be omitted.
+    //
+    // Stylistic Event Attributes
+    // style - the sequence style; block|flow. 
+    inline void fill(yaml_event_t const& event, sequence_start_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+        e.anchor(convert(event.data.sequence_start.anchor));
+        e.tag(convert(event.data.sequence_start.tag));
+        e.anchor_id(0);
+        e.tag_id(0);
+        e.implicit(event.data.sequence_start.implicit);
+        switch(event.data.sequence_start.style)
+        {
+            case YAML_FLOW_SEQUENCE_STYLE:
+                e.style(collection_style::flow);
+                break;
+            case YAML_BLOCK_SEQUENCE_STYLE:
+                e.style(collection_style::block);
+                break;
+            case YAML_ANY_SEQUENCE_STYLE:
+            default:
+                e.style(collection_style::any);
+                break;
+        }
+    }
+
+    inline void fill(yaml_event_t const& event, sequence_end_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+    }
+
+    // Essential Event Attributes
+    // anchor   - the node anchor; [0-9a-zA-Z_-]+; may be NULL.
+    // tag      - the node tag; should either start with ! (local tag) or be a valid URL (global tag); may be NULL or ! in which case implicit should be True.
+    // implicit - True if the node tag may be omitted.
+    //
+    // Stylistic Event Attributes
+    // style - the mapping style; block|flow. 
+    inline void fill(yaml_event_t const& event, mapping_start_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+        e.anchor(convert(event.data.mapping_start.anchor));
+        e.tag(convert(event.data.mapping_start.tag));
+        e.anchor_id(0);
+        e.tag_id(0);
+        e.implicit(event.data.mapping_start.implicit);
+        switch(event.data.mapping_start.style)
+        {
+            case YAML_FLOW_MAPPING_STYLE:
+                e.style(collection_style::flow);
+                break;
+            case YAML_BLOCK_MAPPING_STYLE:
+                e.style(collection_style::block);
+                break;
+            case YAML_ANY_MAPPING_STYLE:
+            default:
+                e.style(collection_style::any);
+                break;
+        }
+    }
+
+    inline void fill(yaml_event_t const& event, mapping_end_event& e, mark_mode marks= mark_mode::full)
+    {
+        fill_marks(event, e, marks);
+    }
+
+    inline void fill(yaml_event_t const& event, yamlman::event& res, mark_mode marks= mark_mode::full)
+    {
+        switch(event.type)
+        {
+            case YAML_STREAM_START_EVENT:
+                fill(event, res.reset<stream_start_event>(), marks);
+                break;
+            case YAML_STREAM_END_EVENT:
+                fill(event, res.reset<stream_end_event>(), marks);
+                break;
+            case YAML_DOCUMENT_START_EVENT:
+                fill(event, res.reset<document_start_event>(), marks);
+                break;
+            case YAML_DOCUMENT_END_EVENT:
+                fill(event, res.reset<document_end_event>(), marks);
+                break;
+            case YAML_ALIAS_EVENT:
+                fill(event, res.reset<alias_event>(), marks);
+                break;
+            case YAML_SCALAR_EVENT:
+                fill(event, res.reset<scalar_event>(), marks);
+                break;
+            case YAML_SEQUENCE_START_EVENT:
+                fill(event, res.reset<sequence_start_event>(), marks);
+                break;
+            case YAML_SEQUENCE_END_EVENT:
+                fill(event, res.reset<sequence_end_event>(), marks);
+                break;
+            case YAML_MAPPING_START_EVENT:
+                fill(event, res.reset<mapping_start_event>(), marks);
+                break;
+            case YAML_MAPPING_END_EVENT:
+                fill(event, res.reset<mapping_end_event>(), marks);
+                break;
+            case YAML_NO_EVENT:
+            default:
+                res= yamlman::event();
+                break;
+        }
+    }
+} // namespace yamlman
+
+#endif // YAMLMAN_LIBYAML_H_
@@ -0,0 +1,66 @@
+#include "line_index.h"
+#include "libyaml.h"
+#include <algorithm>
+
+namespace yamlman
+{
+    line_index::line_index(char const* data, std::size_t size) : _data(data), _size(size)
+    {
+    }
+
+    mark line_index::locate(std::size_t index) const
+    {
+        build();
+
+        std::size_t const line= std::upper_bound(_starts.begin(), _starts.end(), index) - _starts.begin() - 1;
+        mark res;
+
+        res.line(line);
+        res.column(index - _starts[line]);
+        res.index(index);
+
+        return res;
+    }
+
+    std::size_t line_index::lines() const
+    {
+        build();
+
+        return _starts.size();
+    }
+
+    void line_index::build() const
+    {
+        std::call_once(_built, [this]{
+            scan();
+        });
+    }
+
+    void line_index::scan() const
+    {
+        char const* p= _data;
+        char const* const last= _data + _size;
+        std::size_t chars= 0;
+
+        if(has_bom(_data, _size))
+        {
+            p+= 3;
+        }
+
+        _starts.push_back(0);
+        while(p != last)
+        {
+            if(std::size_t const length= line_break(p, last))
+            {
+                chars+= characters(p, p + length);
+                p+= length;
+                _starts.push_back(chars);
+            }
+            else
+            {
+                chars+= (static_cast<unsigned char>(*p) & 0xC0) != 0x80;
+                ++p;
+            }
+        }
+    }
+} // namespace yamlman
@@ -0,0 +1,38 @@
+#ifndef YAMLMAN_LINE_INDEX_H_
+#define YAMLMAN_LINE_INDEX_H_
+
+#include "event.h"
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace yamlman
+{
+    // line and column for a character index into utf-8 input, for marks parsed
+    // with mark_mode::offset. the line starts are found on the first call, in
+    // one pass, with line breaks and a leading byte order mark taken as libyaml
+    // takes them.
+    // locate() may be called from several threads at once. the input is read in
+    // place and must outlive this.
+    class line_index
+    {
+        public:
+            line_index(char const* data, std::size_t size);
+        public:
+            // the mark of a character index, with line and column filled in
+            mark locate(std::size_t index) const;
+            mark locate(mark const& m) const{ return locate(m.index()); }
+            std::size_t lines() const;
+        private:
+            void build() const;
+            void scan() const;
+        private:
+            char const* _data;
+            std::size_t _size;
+            // character index of each line's start, found once
+            mutable std::once_flag _built;
+            mutable std::vector<std::size_t> _starts;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_LINE_INDEX_H_
@@ -0,0 +1,60 @@
+#include "mapped_file.h"
+#include <system_error>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace yamlman
+{
+    mapped_file::mapped_file(std::string const& path) : _data(""), _size(0)
+    {
+        int const fd= ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if(fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+
+        struct stat st;
+
+        if(::fstat(fd, &st) != 0)
+        {
+            int const err= errno;
+
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+
+        // an empty file can't be mapped; it's an empty input
+        if(st.st_size > 0)
+        {
+            void* const p= ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(p == MAP_FAILED)
+            {
+                int const err= errno;
+
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), path);
+            }
+
+            ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+            _data= static_cast<char const*>(p);
+            _size= st.st_size;
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+    }
+
+    mapped_file::~mapped_file()
+    {
+        if(_size > 0)
+        {
+            ::munmap(const_cast<char*>(_data), _size);
+        }
+    }
+} // namespace yamlman
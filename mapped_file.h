@@ -0,0 +1,28 @@
+#ifndef YAMLMAN_MAPPED_FILE_H_
+#define YAMLMAN_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace yamlman
+{
+    // read-only memory mapping of a whole file, advised for sequential access.
+    // throws std::system_error when the file can't be opened or mapped.
+    class mapped_file
+    {
+        public:
+            explicit mapped_file(std::string const& path);
+            ~mapped_file();
+            mapped_file(mapped_file const&)= delete;
+            mapped_file& operator = (mapped_file const&)= delete;
+        public:
+            // never NULL; an empty file is an empty string, which libyaml takes
+            char const* data() const{ return _data; }
+            std::size_t size() const{ return _size; }
+        private:
+            char const* _data;
+            std::size_t _size;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_MAPPED_FILE_H_
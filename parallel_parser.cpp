@@ -0,0 +1,424 @@
+#include "parallel_parser.h"
+#include "parser.h"
+#include "libyaml.h"
+#include "arena.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace yamlman
+{
+    namespace
+    {
+        // a run of whole documents, parsed by one worker
+        struct chunk
+        {
+            std::size_t begin, end;
+            // where the chunk starts in the whole input, to relocate marks
+            std::size_t line, index;
+            std::size_t first_document;
+        };
+
+        struct result
+        {
+            std::vector<event> events;
+            arena strings;
+        };
+
+        // "---" or "..." followed by a blank or the end of the line
+        bool is_marker(char const* line, char const* end, char c)
+        {
+            if(end - line < 3 || line[0] != c || line[1] != c || line[2] != c)
+            {
+                return false;
+            }
+
+            return end - line == 3 || line[3] == ' ' || line[3] == '\t' || line[3] == '\n' || line[3] == '\r';
+        }
+
+        // a line that starts a bare document, one without "---"
+        bool is_content(char const* line, char const* end)
+        {
+            for(; line != end; ++line)
+            {
+                switch(*line)
+                {
+                    case ' ':
+                    case '\t':
+                    case '\r':
+                    case '\n':
+                        continue;
+                    case '#':
+                    case '%':
+                        return false;
+                    default:
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+        // splits the input into chunks of whole documents of about chunk_size bytes.
+        // a cut is only made where a document starts or after "...", so directives
+        // and comments stay with the document they precede.
+        std::vector<chunk> split(char const* data, std::size_t size, std::size_t chunk_size)
+        {
+            std::vector<chunk> chunks;
+            chunk current= chunk{0, 0, 0, 0, 0};
+            std::size_t documents= 0;
+            // the text since the last cut holds a document
+            bool document= false;
+
+            auto const cut= [&](std::size_t end){
+                if(document)
+                {
+                    ++documents;
+                    document= false;
+                }
+                if(end - current.begin >= chunk_size)
+                {
+                    current.end= end;
+                    chunks.push_back(current);
+                    current= chunk{end, 0, 0, 0, documents};
+                }
+            };
+
+            for(std::size_t pos= 0; pos < size; )
+            {
+                char const* const first= data + pos;
+                char const* const newline= static_cast<char const*>(std::memchr(first, '\n', size - pos));
+                char const* const last= newline ? newline + 1 : data + size;
+
+                if(is_marker(first, last, '-'))
+                {
+                    if(document)
+                    {
+                        cut(pos);
+                    }
+                    document= true;
+                }
+                else if(is_marker(first, last, '.'))
+                {
+                    cut(last - data);
+                }
+                else if(!document && is_content(first, last))
+                {
+                    document= true;
+                }
+
+                pos= last - data;
+            }
+
+            current.end= size;
+            chunks.push_back(current);
+
+            return chunks;
+        }
+
+        mark relocate(mark m, chunk const& c)
+        {
+            m.line(m.line() + c.line);
+            m.index(m.index() + c.index);
+
+            return m;
+        }
+
+        void parse_chunk(char const* data, chunk const& c, result& res)
+        {
+            parser parser(data + c.begin, c.end - c.begin);
+
+            while(event const* e= parser.next())
+            {
+                if(e->type() == event_type::stream_start || e->type() == event_type::stream_end)
+                {
+                    continue;
+                }
+
+                res.events.push_back(*e);
+
+                event& ev= res.events.back();
+                base_event* const base= ev.base();
+
+                persist(ev, res.strings);
+                base->start_mark(relocate(base->start_mark(), c));
+                base->end_mark(relocate(base->end_mark(), c));
+            }
+            // only the marks and offset libyaml set; the rest stay empty
+            if(parse_error const* err= parser.error())
+            {
+                bool const marked= err->type() == error_type::scanner || err->type() == error_type::parser;
+
+                throw parse_error(
+                    err->type(),
+                    err->problem(),
+                    marked ? relocate(err->problem_mark(), c) : err->problem_mark(),
+                    err->context(),
+                    err->context().empty() ? err->context_mark() : relocate(err->context_mark(), c),
+                    err->type() == error_type::reader ? err->offset() + c.begin : err->offset()
+                );
+            }
+        }
+
+        // runs f(i) for every i in [0, n) on the given number of threads
+        template<class F>
+        void for_each_index(std::size_t n, unsigned threads, F f)
+        {
+            std::mutex m;
+            std::size_t next= 0;
+            std::exception_ptr error;
+            std::vector<std::thread> pool;
+
+            auto const work= [&]{
+                for(;;)
+                {
+                    std::size_t i;
+                    {
+                        std::lock_guard<std::mutex> lock(m);
+
+                        if(next >= n || error)
+                        {
+                            return;
+                        }
+                        i= next++;
+                    }
+                    try
+                    {
+                        f(i);
+                    }
+                    catch(...)
+                    {
+                        std::lock_guard<std::mutex> lock(m);
+
+                        error= std::current_exception();
+                    }
+                }
+            };
+
+            for(unsigned t= 0; t < threads; ++t)
+            {
+                pool.emplace_back(work);
+            }
+            for(auto& t : pool)
+            {
+                t.join();
+            }
+            if(error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    } // namespace
+
+    parallel_parser::parallel_parser(char const* data, std::size_t size, parallel_options const& options)
+        : _data(data), _size(size), _options(options)
+    {
+        if(!_options.threads)
+        {
+            _options.threads= std::max(1u, std::thread::hardware_concurrency());
+        }
+        if(!_options.window)
+        {
+            _options.window= 2 * _options.threads;
+        }
+        if(!_options.chunk_size)
+        {
+            _options.chunk_size= 1;
+        }
+    }
+
+    parallel_parser::parallel_parser(mapped_file const& file, parallel_options const& options)
+        : parallel_parser(file.data(), file.size(), options)
+    {
+    }
+
+    parallel_parser& parallel_parser::on_event(event_handler_t const& handler)
+    {
+        _handlers.push_back(handler);
+        return *this;
+    }
+
+    void parallel_parser::parse()
+    {
+        std::vector<chunk> chunks= split(_data, _size, _options.chunk_size);
+        std::size_t const n= chunks.size();
+
+        // where the chunks start in characters and lines, for the marks. both are
+        // counted as libyaml counts them, which is past a byte order mark
+        {
+            std::vector<std::size_t> counts(n), lines(n);
+
+            for_each_index(n, _options.threads, [&](std::size_t i){
+                counts[i]= characters(_data + chunks[i].begin, _data + chunks[i].end);
+                lines[i]= line_breaks(_data + chunks[i].begin, _data + chunks[i].end);
+            });
+            if(n)
+            {
+                counts[0]-= has_bom(_data, _size);
+            }
+            for(std::size_t i= 1; i < n; ++i)
+            {
+                chunks[i].index= chunks[i - 1].index + counts[i - 1];
+                chunks[i].line= chunks[i - 1].line + lines[i - 1];
+            }
+        }
+
+        std::vector<std::unique_ptr<result>> results(n);
+        std::mutex m;
+        std::condition_variable cv;
+        std::size_t next= 0, delivered= 0;
+        // chunks parsed but not delivered yet, in completion order
+        std::deque<std::size_t> completed;
+        bool stop= false;
+        // the first chunk that failed, n while none has; error is its exception
+        std::size_t failed= n;
+        std::exception_ptr error;
+
+        // workers stay at most window chunks ahead of delivery, and take no
+        // chunk past a failed one
+        auto const work= [&]{
+            std::unique_lock<std::mutex> lock(m);
+
+            for(;;)
+            {
+                cv.wait(lock, [&]{ return stop || next >= failed || next < delivered + _options.window; });
+                if(stop || next >= failed)
+                {
+                    return;
+                }
+
+                std::size_t const i= next++;
+                std::unique_ptr<result> res(new result);
+
+                lock.unlock();
+                try
+                {
+                    parse_chunk(_data, chunks[i], *res);
+                }
+                catch(...)
+                {
+                    lock.lock();
+                    if(i < failed)
+                    {
+                        failed= i;
+                        error= std::current_exception();
+                    }
+                    cv.notify_all();
+                    continue;
+                }
+                lock.lock();
+
+                results[i]= std::move(res);
+                completed.push_back(i);
+                cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> pool;
+
+        for(unsigned t= 0; t < _options.threads; ++t)
+        {
+            pool.emplace_back(work);
+        }
+
+        // a failed chunk still lets every chunk before it through. none after it
+        // goes out once the failure is known, which in order is all of them.
+        // low is the first chunk not delivered yet
+        std::vector<bool> handed(n);
+        std::size_t low= 0;
+
+        try
+        {
+            for(;;)
+            {
+                std::size_t i;
+                std::unique_ptr<result> res;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+
+                    cv.wait(lock, [&]{
+                        return low >= failed || (_options.ordered ? results[low] != nullptr : !completed.empty());
+                    });
+                    if(low >= failed)
+                    {
+                        break;
+                    }
+
+                    i= _options.ordered ? low : completed.front();
+                    completed.erase(std::find(completed.begin(), completed.end(), i));
+                    res= std::move(results[i]);
+                    // unordered, it may have been parsed before an earlier chunk failed
+                    if(i > failed)
+                    {
+                        res.reset();
+                    }
+                }
+
+                if(res)
+                {
+                    std::size_t document= chunks[i].first_document;
+
+                    for(event const& e : res->events)
+                    {
+                        for(auto const& handler : _handlers)
+                        {
+                            handler(document, e);
+                        }
+                        if(e.type() == event_type::document_end)
+                        {
+                            ++document;
+                        }
+                    }
+                }
+
+                res.reset();
+                handed[i]= true;
+                while(low < n && handed[low])
+                {
+                    ++low;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m);
+
+                    ++delivered;
+                }
+                cv.notify_all();
+            }
+        }
+        catch(...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+
+                stop= true;
+            }
+            cv.notify_all();
+            for(auto& t : pool)
+            {
+                t.join();
+            }
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m);
+
+            stop= true;
+        }
+        cv.notify_all();
+        for(auto& t : pool)
+        {
+            t.join();
+        }
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+} // namespace yamlman
@@ -0,0 +1,51 @@
+#ifndef YAMLMAN_PARALLEL_PARSER_H_
+#define YAMLMAN_PARALLEL_PARSER_H_
+
+#include "event.h"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace yamlman
+{
+    class mapped_file;
+
+    struct parallel_options
+    {
+        // worker threads; 0 is one per core
+        unsigned threads= 0;
+        // documents are grouped into chunks of about this many bytes
+        std::size_t chunk_size= 4 * 1024 * 1024;
+        // chunks parsed ahead of delivery, which bounds memory; 0 is twice the threads
+        std::size_t window= 0;
+        // deliver documents in stream order, or each chunk as soon as it's parsed
+        bool ordered= true;
+    };
+
+    // parses a stream of independent documents on a thread pool. the input is split
+    // at "---" and "..." lines in column 0 and every chunk gets its own libyaml parser.
+    // handlers run on the thread that calls parse(), one document_start..document_end
+    // group at a time, tagged with the document's index in the stream; stream events
+    // are not delivered. marks are relative to the whole input.
+    class parallel_parser
+    {
+        public:
+            typedef std::function<void(std::size_t document, event const& e)> event_handler_t;
+        public:
+            // the input is read in place and must outlive the parser
+            parallel_parser(char const* data, std::size_t size, parallel_options const& options= parallel_options());
+            explicit parallel_parser(mapped_file const& file, parallel_options const& options= parallel_options());
+        public:
+            parallel_parser& on_event(event_handler_t const& handler);
+            // throws parse_error, with marks into the whole input, on malformed input.
+            // the chunks before the malformed one are delivered in full first.
+            void parse();
+        private:
+            char const* _data;
+            std::size_t _size;
+            parallel_options _options;
+            std::vector<event_handler_t> _handlers;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_PARALLEL_PARSER_H_
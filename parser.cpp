@@ -1,567 +1,1178 @@
 #include "parser.h"
-#include <yaml.h>
+#include "libyaml.h"
+#include "mapped_file.h"
+#include "arena.h"
+#include "spsc_ring.h"
+#include "subset_scanner.h"
+#include "path_filter.h"
+#include "fiber.h"
+#include "event_tape.h"
+#include "symbol_table.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <thread>
 #include <vector>
+#include <utility>
 #include <iostream>
 
 namespace yamlman
 {
-    std::string const convert(yaml_char_t const* s)
-    {
-        std::string res;
-
-        while(s && *s)
-        {
-            res.push_back(*s);
-            ++s;
-        }
-
-        return res;
-    }
-
     class parser::impl
     {
         public:
-            typedef std::function<void(yaml_parser_t*)> yaml_parser_deleter_t;
-            typedef std::unique_ptr<yaml_parser_t, yaml_parser_deleter_t> lp_parser_t;
-        public:
-            explicit impl(std::istream& istream) : _parser(make_parser(istream))
+            impl(lp_parser_t parser, char const* data, std::size_t size) : _parser(std::move(parser)), _has_event(false), _done(false), _subscribed(0), _backend(yamlman::backend::libyaml), _data(data), _size(size), _scanned(false), _fast(false), _position(0), _recover(false), _failed(false), _resumed(false), _segment(data), _base_line(0), _base_index(0), _push(false), _closed(false), _feed_data(nullptr), _feed_size(0), _draining(false), _discard(false), _stats(nullptr), _lap(0), _waited(0), _stream(nullptr), _tape(nullptr), _marks(mark_mode::full), _symbols(nullptr)
+            {
+            }
+            ~impl()
             {
+                settle();
+                release();
             }
-            ~impl()= default;
         public:
             void on_stream_start(stream_start_handler_t const& handler)
             {
                 _stream_start_handlers.push_back(handler);
+                subscribe(event_type::stream_start);
             }
 
             void on_stream_end(stream_end_handler_t const& handler)
             {
                 _stream_end_handlers.push_back(handler);
+                subscribe(event_type::stream_end);
             }
 
             void on_document_start(document_start_handler_t const& handler)
             {
                 _document_start_handlers.push_back(handler);
+                subscribe(event_type::document_start);
             }
 
             void on_document_end(document_end_handler_t const& handler)
             {
                 _document_end_handlers.push_back(handler);
+                subscribe(event_type::document_end);
             }
 
             void on_alias(alias_handler_t const& handler)
             {
                 _alias_handlers.push_back(handler);
+                subscribe(event_type::alias);
             }
 
             void on_scalar(scalar_handler_t const& handler)
             {
                 _scalar_handlers.push_back(handler);
+                subscribe(event_type::scalar);
             }
 
             void on_sequence_start(sequence_start_handler_t const& handler)
             {
                 _sequence_start_handlers.push_back(handler);
+                subscribe(event_type::sequence_start);
             }
 
             void on_sequence_end(sequence_end_handler_t const& handler)
             {
                 _sequence_end_handlers.push_back(handler);
+                subscribe(event_type::sequence_end);
             }
 
             void on_mapping_start(mapping_start_handler_t const& handler)
             {
                 _mapping_start_handlers.push_back(handler);
+                subscribe(event_type::mapping_start);
             }
 
             void on_mapping_end(mapping_end_handler_t const& handler)
             {
                 _mapping_end_handlers.push_back(handler);
+                subscribe(event_type::mapping_end);
             }
 
-            void parse()
+            void on_event(event_handler_t const& handler)
             {
-                auto deleter= [](yaml_event_t* event){
-                    if(event)
-                    {
-                        yaml_event_delete(event);
-                    }
-                };
-                typedef std::unique_ptr<yaml_event_t, decltype(deleter)> lp_event_t;
-
-                yaml_event_t event;
-                int done= 0;
-
-                while(!done)
+                _event_handlers.push_back(handler);
+                for(unsigned t= static_cast<unsigned>(event_type::stream_start); t <= static_cast<unsigned>(event_type::mapping_end); ++t)
                 {
-                    lp_event_t pevent(&event, deleter);
-
-                    if(!yaml_parser_parse(_parser.get(), pevent.get()))
-                    {
-                        break;
-                    }
+                    subscribe(static_cast<event_type>(t));
+                }
+            }
 
-                    // process events
-                    switch(event.type)
-                    {
-                        // Stylistic Event Attributes on any event
-                        // start_mark - the position of the event beginning; attributes: index (in characters), line and column (starting from 0).
-                        // end_mark   - the position of the event end; attributes: index (in characters), line and column (starting from 0).
-                        case YAML_STREAM_START_EVENT:{
-                            // Stylistic Event Attributes
-                            // encoding - the document encoding; utf-8|utf-16-le|utf-16-be. 
-                            stream_start_event e;
+            void on_error(error_handler_t const& handler)
+            {
+                _error_handlers.push_back(handler);
+            }
 
-                            {
-                                mark mark;
+            void recover(bool val)
+            {
+                _recover= val;
+            }
 
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+            parse_error const* error() const
+            {
+                return _error ? &*_error : nullptr;
+            }
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+            void backend(yamlman::backend val)
+            {
+                _backend= val;
+            }
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+            void marks(mark_mode val)
+            {
+                _marks= val;
+            }
 
-                                e.end_mark(mark);
-                            }
-                            switch(event.data.stream_start.encoding)
-                            {
-                                case YAML_UTF8_ENCODING:
-                                    e.encoding("UTF-8");
-                                    break;
-                                case YAML_UTF16LE_ENCODING:
-                                    e.encoding("UTF-16LE");
-                                    break;
-                                case YAML_UTF16BE_ENCODING:
-                                    e.encoding("UTF-16BE");
-                                    break;
-                                case YAML_ANY_ENCODING:
-                                    e.encoding("Any");
-                                    break;
-                                default:
-                                    e.encoding("");
-                                    break;
-                            }
+            void symbols(symbol_table* table)
+            {
+                _symbols= table;
+            }
 
-                            for(auto handler : _stream_start_handlers)
-                            {
-                                handler(e);
-                            }
-                            break;
-                        }
-                        case YAML_STREAM_END_EVENT:{
-                            stream_end_event e;
+            void stats(parser_stats* val)
+            {
+                _stats= val;
+            }
 
-                            {
-                                mark mark;
+            parser_stats* stats() const
+            {
+                return _stats;
+            }
 
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+            void select(std::string_view path)
+            {
+                _filter.add(path);
+            }
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+            void reset()
+            {
+                rewind();
+                _push= true;
+                yaml_parser_set_input(_parser.get(), &impl::read_pushed, this);
+                _data= nullptr;
+                _size= 0;
+                _segment= nullptr;
+            }
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+            bool feed(char const* data, std::size_t size)
+            {
+                if(!_push)
+                {
+                    throw std::logic_error("yamlman: feed() needs pushed input; see parser::reset()");
+                }
+                if(_closed)
+                {
+                    throw std::logic_error("yamlman: feed() after the pushed input was finished");
+                }
 
-                                e.end_mark(mark);
-                            }
+                _feed_data= data;
+                _feed_size= size;
+                run();
+                // the caller's buffer is only read during the call
+                _feed_data= nullptr;
+                _feed_size= 0;
 
-                            for(auto handler : _stream_end_handlers)
-                            {
-                                handler(e);
-                            }
-                            break;
-                        }
-                        case YAML_DOCUMENT_START_EVENT:{
-                            // Stylistic Event Attributes
-                            // version_directive - the version specified with the %YAML directive; the only valid value is 1.1; may be NULL.
-                            // tag_directives    - a set of tag handles and the corresponding tag prefixes specified with the %TAG directive; tag handles should match !|!!|![0-9a-zA-Z_-]+! while tag prefixes should be prefixes of valid local or global tags; may be empty.
-                            // implicit          - True if the document start indicator --- is not present.
-                            document_start_event e;
+                return !_failed;
+            }
 
-                            {
-                                mark mark;
+            bool finish()
+            {
+                if(!_push)
+                {
+                    throw std::logic_error("yamlman: finish() needs pushed input; see parser::reset()");
+                }
 
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+                _closed= true;
+                run();
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+                return !_failed;
+            }
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+            void reset(tape_reader const& tape)
+            {
+                rewind();
+                _tape= &tape;
+                _data= nullptr;
+                _size= 0;
+                _segment= nullptr;
+            }
 
-                                e.end_mark(mark);
-                            }
-                            {
-                                std::string version;
-                                yaml_version_directive_t const* const vd= event.data.document_start.version_directive;
+            void reset(std::istream& istream)
+            {
+                rewind();
+                _stream= &istream;
+                yaml_parser_set_input(_parser.get(), &impl::read_stream, this);
+                _data= nullptr;
+                _size= 0;
+                _segment= nullptr;
+            }
 
-                                if(vd)
-                                {
-                                    version+= vd->major;
-                                    version+= ".";
-                                    version+= vd->minor;
-                                }
+            void reset(char const* data, std::size_t size)
+            {
+                rewind();
+                set_input(_parser.get(), data, size);
+                _data= data;
+                _size= size;
+                _segment= data;
+            }
 
-                                e.version_directive(version);
-                            }
+            event const* next()
+            {
+                close();
+                if(_tape)
+                {
+                    while(_position < _tape->size())
+                    {
+                        if(_stats)
+                        {
+                            ++_stats->events[static_cast<std::size_t>(_tape->type(_position))];
+                        }
+                        _tape->get(_position++, _current);
+                        symbolize(_current);
+                        if(selected(_current))
+                        {
+                            if(_filter.done())
                             {
-                                e.tag_directives("");
+                                _position= _tape->size();
                             }
-                            e.implicit(event.data.document_start.implicit);
+                            return &_current;
+                        }
+                    }
+                    return nullptr;
+                }
+                if(fast())
+                {
+                    while(_position < _events.size())
+                    {
+                        event const& e= _events[_position++];
 
-                            for(auto handler : _document_start_handlers)
+                        if(selected(e))
+                        {
+                            if(_filter.done())
                             {
-                                handler(e);
+                                _position= _events.size();
                             }
-                            break;
+                            return &e;
                         }
-                        case YAML_DOCUMENT_END_EVENT:{
-                            // Stylistic Event Attributes
-                            // implicit - True if the document end indicator ... is not present. 
-                            document_end_event e;
-
-                            {
-                                mark mark;
+                    }
+                    return nullptr;
+                }
 
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+                start_lap();
+                while(fetch())
+                {
+                    report();
+                    if(!selected())
+                    {
+                        continue;
+                    }
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+                    fill_current(_current);
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+                    return &_current;
+                }
+                report();
 
-                                e.end_mark(mark);
-                            }
-                            e.implicit(event.data.document_end.implicit);
+                return nullptr;
+            }
 
-                            for(auto handler : _document_end_handlers)
+            bool parse()
+            {
+                close();
+                if(_tape)
+                {
+                    replay();
+                    return true;
+                }
+                // straight from the scanner to the handlers, without storing the events
+                if(!_scanned && _backend == yamlman::backend::fast_path && _data)
+                {
+                    start_lap();
+                    _scanned= true;
+                    _fast= scan_subset(_data, _size, [this](event const& e){
+                        if(_stats)
+                        {
+                            ++_stats->events[static_cast<std::size_t>(e.type())];
+                        }
+                        if(!_filter.done() && selected(e) && subscribed(e.type()))
+                        {
+                            if(_stats)
                             {
-                                handler(e);
+                                _stats->parse_ns+= lap();
                             }
-                            break;
+                            dispatch(e);
                         }
-                        case YAML_ALIAS_EVENT:{
-                            // Essential Event Attributes
-                            // anchor - the alias anchor; [0-9a-zA-Z_-]+; not null.
-                            alias_event e;
-
-                            {
-                                mark mark;
-
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+                    });
+                    if(_stats)
+                    {
+                        _stats->parse_ns+= lap();
+                        _stats->bytes_read+= _fast ? _size : 0;
+                    }
+                    if(_fast)
+                    {
+                        return true;
+                    }
+                }
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+                if(fast())
+                {
+                    start_lap();
+                    while(_position < _events.size())
+                    {
+                        event const& e= _events[_position++];
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+                        if(selected(e) && subscribed(e.type()))
+                        {
+                            dispatch(e);
+                        }
+                        if(_filter.done())
+                        {
+                            _position= _events.size();
+                        }
+                    }
+                    return true;
+                }
 
-                                e.end_mark(mark);
-                            }
-                            e.anchor(convert(event.data.alias.anchor));
+                start_lap();
+                while(fetch())
+                {
+                    report();
+                    // nobody listens; don't pay for the conversion
+                    if(!selected() || !subscribed(to_event_type(_event.type)))
+                    {
+                        continue;
+                    }
 
-                            for(auto handler : _alias_handlers)
-                            {
-                                handler(e);
-                            }
-                            break;
-                        }
-                        case YAML_SCALAR_EVENT:{
-                            // Essential Event Attributes
-                            // anchor          - the node anchor; [0-9a-zA-Z_-]+; may be NULL.
-                            // tag             - the node tag; should either start with ! (local tag) or be a valid URL (global tag); may be NULL or ! in which case either plain_implicit or quoted_implicit should be True.
-                            // plain_implicit  - True if the node tag may be omitted whenever the scalar value is presented in the plain style.
-                            // quoted_implicit - True if the node tag may be omitted whenever the scalar value is presented in any non-plain style.
-                            // value           - the scalar value; a valid utf-8 sequence and may contain NUL characters; not NULL.
-                            // length          - the length of the scalar value.
-                            //
-                            // Stylistic Event Attributes
-                            // style - the value style; plain|single-quoted|double-quoted|literal|folded.
-                            scalar_event e;
+                    fill_current(_current);
+                    dispatch(_current);
+                }
+                report();
 
-                            {
-                                mark mark;
+                return !_failed;
+            }
 
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+            bool parse(pipeline_options const& options)
+            {
+                // the scan is already done; nothing is left to overlap.
+                // pushed input is parsed on its caller's thread, where its fiber lives.
+                if(fast() || _push || _tape)
+                {
+                    return parse();
+                }
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+                // an error ends its batch, so that the consumer reports it
+                // between the events around it
+                struct batch
+                {
+                    std::vector<event> events;
+                    arena strings;
+                    std::vector<parse_error> errors;
+                    bool last;
+                };
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+                std::size_t const batch_size= options.batch_size ? options.batch_size : 1;
+                spsc_ring<batch> ring(options.batches);
+                std::exception_ptr error;
 
-                                e.end_mark(mark);
-                            }
-                            e.anchor(convert(event.data.scalar.anchor));
-                            e.tag(convert(event.data.scalar.tag));
-                            e.plain_implicit(event.data.scalar.plain_implicit);
-                            e.quoted_implicit(event.data.scalar.quoted_implicit);
-                            e.value(convert(event.data.scalar.value));
-                            switch(event.data.scalar.style)
+                // the parsing side: converts and copies events into batches
+                std::thread producer([&]{
+                    try
+                    {
+                        bool more= true;
+                        // the event fetched right after a recovered error, for the next batch
+                        bool carried= false;
+                        auto const add= [&](batch* b){
+                            if(selected() && subscribed(to_event_type(_event.type)))
                             {
-                                case YAML_PLAIN_SCALAR_STYLE:
-                                    e.style("");
-                                    break;
-                                case YAML_SINGLE_QUOTED_SCALAR_STYLE:
-                                    e.style("single-quoted");
-                                    break;
-                                case YAML_DOUBLE_QUOTED_SCALAR_STYLE:
-                                    e.style("double-quoted");
-                                    break;
-                                case YAML_LITERAL_SCALAR_STYLE:
-                                    e.style("literal");
-                                    break;
-                                case YAML_FOLDED_SCALAR_STYLE:
-                                    e.style("folded");
-                                    break;
-                                case YAML_ANY_SCALAR_STYLE:
-                                default:
-                                    e.style("");
-                                    break;
+                                b->events.emplace_back();
+                                fill_current(b->events.back(), false);
+                                persist(b->events.back(), b->strings);
+                                if(_stats)
+                                {
+                                    _stats->convert_ns+= lap();
+                                }
                             }
+                        };
 
-                            for(auto handler : _scalar_handlers)
-                            {
-                                handler(e);
-                            }
-                            break;
-                        }
-                        case YAML_SEQUENCE_START_EVENT:{
-                            // Essential Event Attributes
-                            // anchor   - the node anchor; [0-9a-zA-Z_-]+; may be NULL.
-                            // tag      - the node tag; should either start with ! (local tag) or be a valid URL (global tag); may be NULL or ! in which case implicit should be True.
-                            // implicit - True if the node tag may be omitted.
-                            //
-                            // Stylistic Event Attributes
-                            // style - the sequence style; block|flow. 
-                            sequence_start_event e;
+                        while(more)
+                        {
+                            batch* const b= ring.wait_acquire();
 
+                            // the consumer gave up
+                            if(!b)
                             {
-                                mark mark;
-
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
-
-                                e.start_mark(mark);
+                                return;
                             }
-                            {
-                                mark mark;
+                            // waiting for the consumer is nobody's time
+                            start_lap();
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
-
-                                e.end_mark(mark);
-                            }
-                            e.anchor(convert(event.data.sequence_start.anchor));
-                            e.tag(convert(event.data.sequence_start.tag));
-                            e.implicit(event.data.sequence_start.implicit);
-                            switch(event.data.sequence_start.style)
+                            b->events.clear();
+                            b->strings.clear();
+                            b->errors.clear();
+                            if(carried)
                             {
-                                case YAML_FLOW_SEQUENCE_STYLE:
-                                    e.style("flow");
-                                    break;
-                                case YAML_BLOCK_SEQUENCE_STYLE:
-                                    e.style("block");
-                                    break;
-                                case YAML_ANY_SEQUENCE_STYLE:
-                                    e.style("any");
-                                    break;
-                                default:
-                                    e.style("");
-                                    break;
+                                add(b);
+                                carried= false;
                             }
-
-                            for(auto handler : _sequence_start_handlers)
+                            while(b->events.size() < batch_size && (more= fetch()))
                             {
-                                handler(e);
+                                if(!_unreported.empty())
+                                {
+                                    carried= true;
+                                    break;
+                                }
+                                add(b);
                             }
-                            break;
+                            b->errors.swap(_unreported);
+                            b->last= !more;
+                            ring.publish();
                         }
-                        case YAML_SEQUENCE_END_EVENT:{
-                            sequence_end_event e;
-
-                            {
-                                mark mark;
-
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+                    }
+                    catch(...)
+                    {
+                        error= std::current_exception();
+                        ring.close();
+                    }
+                });
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+                // the handler side, on the caller's thread
+                try
+                {
+                    for(;;)
+                    {
+                        batch* const b= ring.wait_front();
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+                        // the producer failed
+                        if(!b)
+                        {
+                            break;
+                        }
 
-                                e.end_mark(mark);
-                            }
+                        // _lap belongs to the parsing thread; a batch is timed as a whole
+                        std::uint64_t const start= _stats ? now() : 0;
 
-                            for(auto handler : _sequence_end_handlers)
+                        for(event& e : b->events)
+                        {
+                            symbolize(e);
+                            deliver(e);
+                        }
+                        if(_stats)
+                        {
+                            _stats->handler_ns+= now() - start;
+                        }
+                        for(parse_error const& err : b->errors)
+                        {
+                            for(auto const& handler : _error_handlers)
                             {
-                                handler(e);
+                                handler(err);
                             }
-                            break;
                         }
-                        case YAML_MAPPING_START_EVENT:{
-                            // Essential Event Attributes
-                            // anchor   - the node anchor; [0-9a-zA-Z_-]+; may be NULL.
-                            // tag      - the node tag; should either start with ! (local tag) or be a valid URL (global tag); may be NULL or ! in which case implicit should be True.
-                            // implicit - True if the node tag may be omitted.
-                            //
-                            // Stylistic Event Attributes
-                            // style - the mapping style; block|flow. 
-                            mapping_start_event e;
-
-                            {
-                                mark mark;
 
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+                        bool const last= b->last;
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+                        ring.pop();
+                        if(last)
+                        {
+                            break;
+                        }
+                    }
+                }
+                catch(...)
+                {
+                    ring.close();
+                    producer.join();
+                    throw;
+                }
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+                producer.join();
+                if(error)
+                {
+                    std::rethrow_exception(error);
+                }
 
-                                e.end_mark(mark);
-                            }
-                            e.anchor(convert(event.data.mapping_start.anchor));
-                            e.tag(convert(event.data.mapping_start.tag));
-                            e.implicit(event.data.mapping_start.implicit);
-                            switch(event.data.mapping_start.style)
-                            {
-                                case YAML_FLOW_MAPPING_STYLE:
-                                    e.style("flow");
-                                    break;
-                                case YAML_BLOCK_MAPPING_STYLE:
-                                    e.style("block");
-                                    break;
-                                case YAML_ANY_MAPPING_STYLE:
-                                    e.style("any");
-                                    break;
-                                default:
-                                    e.style("");
-                                    break;
-                            }
+                return !_failed;
+            }
+        private:
+            // whether the current libyaml event is under a selector; once all of
+            // them are satisfied, the stream is treated as ended
+            bool selected()
+            {
+                if(_filter.empty())
+                {
+                    return true;
+                }
 
-                            for(auto handler : _mapping_start_handlers)
-                            {
-                                handler(e);
-                            }
-                            break;
-                        }
-                        case YAML_MAPPING_END_EVENT:{
-                            mapping_end_event e;
+                event_type const type= to_event_type(_event.type);
+                bool const res= _filter.accept(type, type == event_type::scalar ? convert(_event.data.scalar.value, _event.data.scalar.length) : std::string_view());
 
-                            {
-                                mark mark;
+                if(_filter.done())
+                {
+                    _done= true;
+                }
 
-                                mark.line(event.start_mark.line);
-                                mark.column(event.start_mark.column);
-                                mark.index(event.start_mark.index);
+                return res;
+            }
 
-                                e.start_mark(mark);
-                            }
-                            {
-                                mark mark;
+            bool selected(event const& e)
+            {
+                if(_filter.empty())
+                {
+                    return true;
+                }
 
-                                mark.line(event.end_mark.line);
-                                mark.column(event.end_mark.column);
-                                mark.index(event.end_mark.index);
+                return _filter.accept(e.type(), e.type() == event_type::scalar ? e.get<scalar_event>().value() : std::string_view());
+            }
 
-                                e.end_mark(mark);
-                            }
+            bool subscribed(event_type type) const
+            {
+                return _subscribed & (1u << static_cast<unsigned>(type));
+            }
 
-                            for(auto handler : _mapping_end_handlers)
+            // whether this input's events come from the subset scanner, stored for
+            // next(); it is tried once per input, before libyaml has read anything
+            bool fast()
+            {
+                if(!_scanned)
+                {
+                    start_lap();
+                    _scanned= true;
+                    _fast= _backend == yamlman::backend::fast_path && _data && scan_subset(_data, _size, _events);
+                    if(!_fast)
+                    {
+                        _events.clear();
+                    }
+                    if(_stats)
+                    {
+                        _stats->parse_ns+= lap();
+                        if(_fast)
+                        {
+                            _stats->bytes_read+= _size;
+                            for(event const& e : _events)
                             {
-                                handler(e);
+                                ++_stats->events[static_cast<std::size_t>(e.type())];
                             }
-                            break;
                         }
-                        case YAML_NO_EVENT:
-                        default:
-                            break;
                     }
-
-                    done= (event.type == YAML_STREAM_END_EVENT);
                 }
+
+                return _fast;
             }
-        private:
-            static lp_parser_t make_parser(std::istream& istream)
+
+            // handlers stay registered; only the libyaml state starts over
+            void rewind()
             {
-                lp_parser_t parser(new yaml_parser_t, [](yaml_parser_t* p){
-                    if(p)
-                    {
-                        yaml_parser_delete(p);
-                        delete p;
-                    }
-                });
+                settle();
+                release();
+                reset_parser(_parser.get());
+                _push= false;
+                _closed= false;
+                _tape= nullptr;
+                _done= false;
+                _scanned= false;
+                _fast= false;
+                _events.clear();
+                _position= 0;
+                _filter.rewind();
+                _error.reset();
+                _unreported.clear();
+                _failed= false;
+                _resumed= false;
+                _base_line= 0;
+                _base_index= 0;
+            }
 
-                yaml_parser_initialize(parser.get());
+            void subscribe(event_type type)
+            {
+                _subscribed|= 1u << static_cast<unsigned>(type);
+            }
 
-                yaml_parser_set_input(
-                    parser.get(),
-                    [](void* ext, unsigned char* buffer, size_t size, size_t* size_read)->int{
-                        std::istream* istream= static_cast<std::istream*>(ext);
-                        std::istream& read= istream->read(reinterpret_cast<char*>(buffer), size);
+            bool fetch()
+            {
+                release();
 
-                        *size_read= read.gcount();
+                if(_done)
+                {
+                    return false;
+                }
 
-                        // error:   0
-                        // eof: (size_read, ret) = (0, 1)
-                        // success: 1
-                        return 1;
-                    },
-                    &istream
-                );
+                for(;;)
+                {
+                    bool const parsed= yaml_parser_parse(_parser.get(), &_event);
+
+                    if(_stats)
+                    {
+                        account(parsed);
+                    }
+                    if(parsed)
+                    {
+                        _has_event= true;
+                        // a resumed parse starts a stream of its own, whose start is dropped
+                        if(_resumed && _event.type == YAML_STREAM_START_EVENT)
+                        {
+                            _resumed= false;
+                            release();
+                            continue;
+                        }
+                        _done= (_event.type == YAML_STREAM_END_EVENT);
+
+                        return true;
+                    }
+
+                    _error.emplace(located(make_error(*_parser)));
+                    _unreported.push_back(*_error);
+                    _failed= true;
+                    if(!resume())
+                    {
+                        _done= true;
+                        return false;
+                    }
+                }
+            }
+
+            // after an error, parsing goes on with a fresh libyaml state at the
+            // next line starting with ---, at or after the line of the problem.
+            // only in-memory input can be skipped through like this.
+            bool resume()
+            {
+                if(!_recover || !_segment || _parser->error == YAML_MEMORY_ERROR)
+                {
+                    return false;
+                }
+
+                char const* const end= _data + _size;
+                char const* line= _segment;
+
+                if(_parser->error == YAML_READER_ERROR)
+                {
+                    line+= std::min(_parser->problem_offset, static_cast<std::size_t>(end - _segment));
+                    while(line != _segment && line[-1] != '\n')
+                    {
+                        --line;
+                    }
+                }
+                else
+                {
+                    for(std::size_t n= 0; n < _parser->problem_mark.line && line != end; ++n)
+                    {
+                        char const* const eol= static_cast<char const*>(std::memchr(line, '\n', end - line));
+
+                        line= eol ? eol + 1 : end;
+                    }
+                }
+
+                while(line != end)
+                {
+                    char const* const eol= static_cast<char const*>(std::memchr(line, '\n', end - line));
+                    std::size_t const length= (eol ? eol : end) - line;
+
+                    // never the segment's own start, so that every resume moves on
+                    if(line != _segment && length >= 3 && std::memcmp(line, "---", 3) == 0 && (length == 3 || line[3] == ' ' || line[3] == '\t' || line[3] == '\r'))
+                    {
+                        break;
+                    }
+                    line= eol ? eol + 1 : end;
+                }
+                if(line == end)
+                {
+                    return false;
+                }
+
+                _base_line+= line_breaks(_segment, line);
+                _base_index+= characters(_segment, line) - (_segment == _data && has_bom(_data, _size));
+                _segment= line;
+                reset_parser(_parser.get());
+                set_input(_parser.get(), line, end - line);
+                _resumed= true;
+
+                return true;
+            }
+
+            // marks of a resumed parse count from its segment; these make them
+            // count from the start of the input again
+            mark located(mark m) const
+            {
+                m.line(m.line() + _base_line);
+                m.index(m.index() + _base_index);
+
+                return m;
+            }
+
+            parse_error located(parse_error const& e) const
+            {
+                if(!_base_line && !_base_index && _segment == _data)
+                {
+                    return e;
+                }
+
+                bool const marked= e.type() == error_type::scanner || e.type() == error_type::parser;
+
+                return parse_error(
+                    e.type(),
+                    e.problem(),
+                    marked ? located(e.problem_mark()) : e.problem_mark(),
+                    e.context(),
+                    e.context().empty() ? e.context_mark() : located(e.context_mark()),
+                    e.type() == error_type::reader ? e.offset() + (_segment - _data) : e.offset()
+                );
+            }
+
+            // the pipeline's parsing thread leaves interning to the handlers' thread
+            void fill_current(event& e, bool intern= true)
+            {
+                fill(_event, e, _marks);
+                if((_base_line || _base_index) && _marks != mark_mode::none)
+                {
+                    base_event* const base= e.base();
+                    mark start= base->start_mark(), end= base->end_mark();
+
+                    if(_marks == mark_mode::full)
+                    {
+                        start= located(start);
+                        end= located(end);
+                    }
+                    else
+                    {
+                        start.index(start.index() + _base_index);
+                        end.index(end.index() + _base_index);
+                    }
+                    base->start_mark(start);
+                    base->end_mark(end);
+                }
+                if(intern)
+                {
+                    symbolize(e);
+                }
+                if(_stats)
+                {
+                    _stats->convert_ns+= lap();
+                }
+            }
+
+            void symbolize(event& e)
+            {
+                if(_symbols)
+                {
+                    _symbols->intern(e);
+                }
+            }
+
+            // a recorded stream, decoded only where someone listens
+            void replay()
+            {
+                start_lap();
+                while(_position < _tape->size())
+                {
+                    event_type const type= _tape->type(_position);
+
+                    if(_stats)
+                    {
+                        ++_stats->events[static_cast<std::size_t>(type)];
+                    }
+                    if(subscribed(type) || !_filter.empty())
+                    {
+                        _tape->get(_position, _current);
+                        symbolize(_current);
+                        if(_stats)
+                        {
+                            _stats->convert_ns+= lap();
+                        }
+                        if(selected(_current) && subscribed(type))
+                        {
+                            dispatch(_current);
+                        }
+                        if(_filter.done())
+                        {
+                            _position= _tape->size();
+                            break;
+                        }
+                    }
+                    ++_position;
+                }
+            }
+
+            // pushed input is parsed on a fiber, handlers included, as if it were
+            // a blocking stream: the read handler suspends the fiber when the fed
+            // data runs out, and feed() returns with the parse halfway. switching
+            // only there keeps the cost per chunk, not per event. the stack only
+            // takes memory as deep as the handlers go, so it is sized for them.
+            void run()
+            {
+                if(!_fiber)
+                {
+                    _fiber.reset(new fiber([this]{
+                        for(;;)
+                        {
+                            _draining= true;
+                            try
+                            {
+                                drain();
+                            }
+                            catch(...)
+                            {
+                                _thrown= std::current_exception();
+                            }
+                            _draining= false;
+                            _fiber->suspend();
+                        }
+                    }, 1024 * 1024));
+                }
+
+                // a stream already done has nothing left to parse
+                if(_draining || !_done)
+                {
+                    _fiber->resume();
+                }
+                if(_thrown)
+                {
+                    std::exception_ptr const thrown= _thrown;
+
+                    _thrown= nullptr;
+                    std::rethrow_exception(thrown);
+                }
+            }
+
+            static int read_pushed(void* ext, unsigned char* buffer, std::size_t size, std::size_t* size_read)
+            {
+                impl* const self= static_cast<impl*>(ext);
+
+                if(!self->_feed_size && !self->_closed)
+                {
+                    // time waiting for the next feed() isn't spent in libyaml
+                    std::uint64_t const start= self->_stats ? now() : 0;
+
+                    while(!self->_feed_size && !self->_closed)
+                    {
+                        self->_fiber->suspend();
+                    }
+                    if(self->_stats)
+                    {
+                        self->_waited+= now() - start;
+                    }
+                }
+
+                std::size_t const n= std::min(size, self->_feed_size);
+
+                // at the end of the input there may be no data pointer at all
+                if(n)
+                {
+                    std::memcpy(buffer, self->_feed_data, n);
+                }
+                self->_feed_data+= n;
+                self->_feed_size-= n;
+                *size_read= n;
+                if(self->_stats)
+                {
+                    self->_stats->bytes_read+= n;
+                }
+
+                return 1;
+            }
+
+            static int read_stream(void* ext, unsigned char* buffer, std::size_t size, std::size_t* size_read)
+            {
+                impl* const self= static_cast<impl*>(ext);
+                std::istream& read= self->_stream->read(reinterpret_cast<char*>(buffer), size);
+
+                *size_read= read.gcount();
+                if(self->_stats)
+                {
+                    self->_stats->bytes_read+= *size_read;
+                }
+
+                // eof sets failbit as well; only badbit is a failed read
+                return read.bad() ? 0 : 1;
+            }
+
+            static std::uint64_t now()
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            // phases are timed back to back, with one clock read where one ends
+            // and the next starts; start_lap() marks where the caller's time ends
+            void start_lap()
+            {
+                if(_stats)
+                {
+                    _lap= now();
+                }
+            }
+
+            std::uint64_t lap()
+            {
+                std::uint64_t const t= now(), res= t - _lap;
+
+                _lap= t;
+
+                return res;
+            }
+
+            // one yaml_parser_parse call, and the event it made
+            void account(bool parsed)
+            {
+                _stats->parse_ns+= lap() - _waited;
+                _waited= 0;
+                if(!parsed)
+                {
+                    return;
+                }
+
+                auto const allocated= [this](yaml_char_t const* s, std::size_t length){
+                    if(s)
+                    {
+                        ++_stats->strings;
+                        _stats->string_bytes+= length + 1;
+                    }
+                };
+                auto const length= [](yaml_char_t const* s){
+                    return s ? std::strlen(reinterpret_cast<char const*>(s)) : 0;
+                };
+
+                ++_stats->events[static_cast<std::size_t>(to_event_type(_event.type))];
+                switch(_event.type)
+                {
+                    case YAML_STREAM_START_EVENT:
+                        _stats->bytes_read+= _segment == _data ? _size : 0;
+                        break;
+                    case YAML_ALIAS_EVENT:
+                        allocated(_event.data.alias.anchor, length(_event.data.alias.anchor));
+                        break;
+                    case YAML_SCALAR_EVENT:
+                        allocated(_event.data.scalar.anchor, length(_event.data.scalar.anchor));
+                        allocated(_event.data.scalar.tag, length(_event.data.scalar.tag));
+                        allocated(_event.data.scalar.value, _event.data.scalar.length);
+                        break;
+                    case YAML_SEQUENCE_START_EVENT:
+                        allocated(_event.data.sequence_start.anchor, length(_event.data.sequence_start.anchor));
+                        allocated(_event.data.sequence_start.tag, length(_event.data.sequence_start.tag));
+                        break;
+                    case YAML_MAPPING_START_EVENT:
+                        allocated(_event.data.mapping_start.anchor, length(_event.data.mapping_start.anchor));
+                        allocated(_event.data.mapping_start.tag, length(_event.data.mapping_start.tag));
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            // next() and parse() take pushed input as finished; a parse that
+            // feed() left halfway is finished first, with its handlers
+            void close()
+            {
+                if(_push && !_closed)
+                {
+                    _closed= true;
+                    if(_draining)
+                    {
+                        run();
+                    }
+                }
+            }
 
-                return parser;
+            // lets a parse waiting for input run to its end without the handlers,
+            // so that libyaml frees what it holds
+            void settle()
+            {
+                if(_draining)
+                {
+                    _closed= true;
+                    _feed_size= 0;
+                    _discard= true;
+                    while(_draining)
+                    {
+                        _fiber->resume();
+                    }
+                    _discard= false;
+                    _thrown= nullptr;
+                }
+            }
+
+            void drain()
+            {
+                start_lap();
+                while(fetch())
+                {
+                    if(_discard)
+                    {
+                        continue;
+                    }
+                    report();
+                    if(!selected() || !subscribed(to_event_type(_event.type)))
+                    {
+                        continue;
+                    }
+
+                    fill_current(_current);
+                    dispatch(_current);
+                }
+                if(!_discard)
+                {
+                    report();
+                }
+            }
+
+            // hands the errors found by fetch() to the handlers, before the events after them
+            void report()
+            {
+                if(_unreported.empty())
+                {
+                    return;
+                }
+
+                std::vector<parse_error> errors;
+
+                errors.swap(_unreported);
+                for(parse_error const& err : errors)
+                {
+                    for(auto const& handler : _error_handlers)
+                    {
+                        handler(err);
+                    }
+                }
+            }
+
+            void release()
+            {
+                if(_has_event)
+                {
+                    yaml_event_delete(&_event);
+                    _has_event= false;
+                }
+            }
+
+            void dispatch(yamlman::event const& e)
+            {
+                deliver(e);
+                if(_stats)
+                {
+                    _stats->handler_ns+= lap();
+                }
             }
+
+            void deliver(yamlman::event const& e)
+            {
+                switch(e.type())
+                {
+                    case event_type::stream_start:
+                        for(auto const& handler : _stream_start_handlers)
+                        {
+                            handler(e.get<stream_start_event>());
+                        }
+                        break;
+                    case event_type::stream_end:
+                        for(auto const& handler : _stream_end_handlers)
+                        {
+                            handler(e.get<stream_end_event>());
+                        }
+                        break;
+                    case event_type::document_start:
+                        for(auto const& handler : _document_start_handlers)
+                        {
+                            handler(e.get<document_start_event>());
+                        }
+                        break;
+                    case event_type::document_end:
+                        for(auto const& handler : _document_end_handlers)
+                        {
+                            handler(e.get<document_end_event>());
+                        }
+                        break;
+                    case event_type::alias:
+                        for(auto const& handler : _alias_handlers)
+                        {
+                            handler(e.get<alias_event>());
+                        }
+                        break;
+                    case event_type::scalar:
+                        for(auto const& handler : _scalar_handlers)
+                        {
+                            handler(e.get<scalar_event>());
+                        }
+                        break;
+                    case event_type::sequence_start:
+                        for(auto const& handler : _sequence_start_handlers)
+                        {
+                            handler(e.get<sequence_start_event>());
+                        }
+                        break;
+                    case event_type::sequence_end:
+                        for(auto const& handler : _sequence_end_handlers)
+                        {
+                            handler(e.get<sequence_end_event>());
+                        }
+                        break;
+                    case event_type::mapping_start:
+                        for(auto const& handler : _mapping_start_handlers)
+                        {
+                            handler(e.get<mapping_start_event>());
+                        }
+                        break;
+                    case event_type::mapping_end:
+                        for(auto const& handler : _mapping_end_handlers)
+                        {
+                            handler(e.get<mapping_end_event>());
+                        }
+                        break;
+                    case event_type::none:
+                    default:
+                        break;
+                }
+                for(auto const& handler : _event_handlers)
+                {
+                    handler(e);
+                }
+            }
+
         private:
             lp_parser_t _parser;
+            yaml_event_t _event;
+            bool _has_event, _done;
+            unsigned _subscribed;
+            yamlman::event _current;
+            yamlman::backend _backend;
+            // the in-memory input, for the fast path; nullptr for streams
+            char const* _data;
+            std::size_t _size;
+            bool _scanned, _fast;
+            std::vector<event> _events;
+            std::size_t _position;
+            path_filter _filter;
+            bool _recover;
+            // set once any error was found in this input
+            bool _failed;
+            bool _resumed;
+            // the last error, and those not handed to the handlers yet
+            std::optional<parse_error> _error;
+            std::vector<parse_error> _unreported;
+            // where libyaml's current input starts, and the lines and characters before it
+            char const* _segment;
+            std::size_t _base_line, _base_index;
+            // pushed input, and whether its end was announced
+            bool _push, _closed;
+            // what the current feed() has left
+            char const* _feed_data;
+            std::size_t _feed_size;
+            std::unique_ptr<fiber> _fiber;
+            // the fiber is inside drain(); _discard drops what it parses
+            bool _draining, _discard;
+            // from a handler on the fiber, for the caller of feed()
+            std::exception_ptr _thrown;
+            parser_stats* _stats;
+            // when the phase being timed started
+            std::uint64_t _lap;
+            // time the fiber spent suspended inside the current libyaml call
+            std::uint64_t _waited;
+            std::istream* _stream;
+            // recorded input, replayed instead of parsed
+            tape_reader const* _tape;
+            mark_mode _marks;
+            symbol_table* _symbols;
+            std::vector<event_handler_t> _event_handlers;
+            std::vector<error_handler_t> _error_handlers;
             std::vector<stream_start_handler_t>   _stream_start_handlers;
             std::vector<stream_end_handler_t>     _stream_end_handlers;
             std::vector<document_start_handler_t> _document_start_handlers;
@@ -574,7 +1185,30 @@ namespace yamlman
             std::vector<mapping_end_handler_t>    _mapping_end_handlers;
     };
 
-    parser::parser(std::istream& istream) : _impl(new impl(istream))
+    parser::parser() : _impl(new impl(make_parser(), nullptr, 0))
+    {
+        _impl->reset();
+    }
+
+    parser::parser(std::istream& istream) : _impl(new impl(make_parser(), nullptr, 0))
+    {
+        _impl->reset(istream);
+    }
+
+    parser::parser(char const* data, std::size_t size) : _impl(new impl(make_parser(data, size), data, size))
+    {
+    }
+
+    parser::parser(std::string_view input) : _impl(new impl(make_parser(input.data(), input.size()), input.data(), input.size()))
+    {
+    }
+
+    parser::parser(tape_reader const& tape) : _impl(new impl(make_parser(), nullptr, 0))
+    {
+        _impl->reset(tape);
+    }
+
+    parser::parser(mapped_file const& file) : _impl(new impl(make_parser(file.data(), file.size()), file.data(), file.size()))
     {
     }
 
@@ -640,9 +1274,128 @@ namespace yamlman
         return *this;
     }
 
-    void parser::parse()
+    parser& parser::on_event(event_handler_t const& handler)
+    {
+        _impl->on_event(handler);
+        return *this;
+    }
+
+    parser& parser::on_error(error_handler_t const& handler)
+    {
+        _impl->on_error(handler);
+        return *this;
+    }
+
+    parser& parser::recover(bool val)
+    {
+        _impl->recover(val);
+        return *this;
+    }
+
+    parse_error const* parser::error() const
+    {
+        return _impl->error();
+    }
+
+    parser& parser::backend(yamlman::backend val)
+    {
+        _impl->backend(val);
+        return *this;
+    }
+
+    parser& parser::marks(mark_mode val)
+    {
+        _impl->marks(val);
+        return *this;
+    }
+
+    parser& parser::symbols(symbol_table* table)
+    {
+        _impl->symbols(table);
+        return *this;
+    }
+
+    parser& parser::stats(parser_stats* val)
+    {
+        _impl->stats(val);
+        return *this;
+    }
+
+    parser_stats* parser::stats() const
+    {
+        return _impl->stats();
+    }
+
+    parser& parser::select(std::string_view path)
+    {
+        _impl->select(path);
+        return *this;
+    }
+
+    parser& parser::reset()
+    {
+        _impl->reset();
+        return *this;
+    }
+
+    bool parser::feed(char const* data, std::size_t size)
+    {
+        return _impl->feed(data, size);
+    }
+
+    bool parser::feed(std::string_view data)
+    {
+        return _impl->feed(data.data(), data.size());
+    }
+
+    bool parser::finish()
+    {
+        return _impl->finish();
+    }
+
+    parser& parser::reset(tape_reader const& tape)
+    {
+        _impl->reset(tape);
+        return *this;
+    }
+
+    parser& parser::reset(std::istream& istream)
+    {
+        _impl->reset(istream);
+        return *this;
+    }
+
+    parser& parser::reset(char const* data, std::size_t size)
+    {
+        _impl->reset(data, size);
+        return *this;
+    }
+
+    parser& parser::reset(std::string_view input)
+    {
+        _impl->reset(input.data(), input.size());
+        return *this;
+    }
+
+    parser& parser::reset(mapped_file const& file)
+    {
+        _impl->reset(file.data(), file.size());
+        return *this;
+    }
+
+    event const* parser::next()
+    {
+        return _impl->next();
+    }
+
+    bool parser::parse()
+    {
+        return _impl->parse();
+    }
+
+    bool parser::parse(pipeline_options const& options)
     {
-        _impl->parse();
+        return _impl->parse(options);
     }
 } // namespace yaml
 
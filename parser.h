@@ -2,12 +2,51 @@
 #define YAMLMAN_PARSER_H_
 
 #include "event.h"
+#include <array>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <iostream>
+#include <string_view>
 
 namespace yamlman
 {
+    class mapped_file;
+    class tape_reader;
+    class symbol_table;
+
+    enum class backend
+    {
+        libyaml,
+        // the vectorized scanner in subset_scanner.h for in-memory input within
+        // its subset; any other input still goes to libyaml
+        fast_path,
+    };
+
+    struct pipeline_options
+    {
+        // events handed over from the parsing thread at a time
+        std::size_t batch_size= 256;
+        // batches in flight; the parsing thread waits when all of them are full
+        std::size_t batches= 8;
+    };
+
+    // counters a parser adds to while one is attached with parser::stats().
+    // they only grow; assign parser_stats() to start over.
+    struct parser_stats
+    {
+        // events parsed, selected or not, indexed by event_type
+        std::array<std::uint64_t, 11> events= {};
+        // input handed to the parser; in-memory input counts whole as its stream starts
+        std::uint64_t bytes_read= 0;
+        // anchors, tags and scalar values libyaml allocated for events, and their
+        // bytes with the terminating NUL; the fast path allocates none
+        std::uint64_t strings= 0, string_bytes= 0;
+        // nanoseconds spent in libyaml or the subset scanner, in converting
+        // libyaml's events, and in handlers
+        std::uint64_t parse_ns= 0, convert_ns= 0, handler_ns= 0;
+    };
+
     class parser
     {
         public:
@@ -21,8 +60,19 @@ namespace yamlman
             typedef std::function<void(sequence_end_event const&)>   sequence_end_handler_t;
             typedef std::function<void(mapping_start_event const&)>  mapping_start_handler_t;
             typedef std::function<void(mapping_end_event const&)>    mapping_end_handler_t;
+            typedef std::function<void(parse_error const&)>          error_handler_t;
+            typedef std::function<void(yamlman::event const&)>       event_handler_t;
         public:
+            // starts on pushed input, see feed(); parsed as it is, it's an empty stream
+            parser();
             explicit parser(std::istream& istream);
+            // in-memory input is read in place, without a copy;
+            // the buffer or mapping must outlive the parser.
+            parser(char const* data, std::size_t size);
+            explicit parser(std::string_view input);
+            explicit parser(mapped_file const& file);
+            // replays a tape recorded with tape_writer, without libyaml; see event_tape.h
+            explicit parser(tape_reader const& tape);
             ~parser();
         public:
             parser& on_stream_start(stream_start_handler_t const& handler);
@@ -35,7 +85,76 @@ namespace yamlman
             parser& on_sequence_end(sequence_end_handler_t const& handler);
             parser& on_mapping_start(mapping_start_handler_t const& handler);
             parser& on_mapping_end(mapping_end_handler_t const& handler);
-            void parse();
+            // every event as one tagged type, after the handlers of its own type
+            parser& on_event(event_handler_t const& handler);
+            // called for each parse error, in stream order with the events and
+            // from every way of parsing; a handler may throw to stop parsing.
+            parser& on_error(error_handler_t const& handler);
+            // with in-memory input, goes on after an error at the next line
+            // starting with ---, as a fresh parse whose marks still count from the
+            // start of the input; the broken document's events just stop there.
+            // off by default: parsing ends at the first error.
+            parser& recover(bool val);
+            // the last error in the current input, nullptr if there was none
+            parse_error const* error() const;
+            // chosen when parsing of an input starts; libyaml by default
+            parser& backend(yamlman::backend val);
+            // full marks by default. offset leaves line and column to line_index,
+            // none skips them and leaves the events' marks unspecified; parse errors
+            // keep full marks either way. the fast path has its marks at hand and
+            // fills them in any mode; a tape fills in what it recorded, see tape_reader.
+            // a change applies from the next event parsed, so set it before parse():
+            // the pipelined one parses ahead on its own thread.
+            parser& marks(mark_mode val);
+            // counts into val from now on, until detached with nullptr; val must
+            // outlive its use. with none attached, each event still passes the
+            // checks for it after parsing, converting and dispatching: three or
+            // four well-predicted branches, and no clock reads.
+            // the pipelined parse() writes the handler time on the calling thread
+            // and the rest on the parsing one.
+            parser& stats(parser_stats* val);
+            parser_stats* stats() const;
+            // interns tags and anchors into table, which sets the events' ids and
+            // makes their views last as long as the table; nullptr stops it.
+            // with parse(pipeline_options) the table is still only used from the
+            // handlers' thread.
+            parser& symbols(symbol_table* table);
+            // delivers only the events inside nodes picked by a selector such as
+            // a.b[*].c, see path_filter.h; each call adds one. events outside are
+            // neither converted nor dispatched. without wildcards, parsing stops
+            // as soon as every selector has delivered its node, later documents
+            // included. throws std::invalid_argument on a malformed selector.
+            parser& select(std::string_view path);
+            // starts over on a new input, keeping the registered handlers and
+            // the libyaml parser object; for parsing many small documents.
+            // without arguments, the input is pushed by feed() and finish().
+            parser& reset();
+            parser& reset(std::istream& istream);
+            parser& reset(char const* data, std::size_t size);
+            parser& reset(std::string_view input);
+            parser& reset(mapped_file const& file);
+            parser& reset(tape_reader const& tape);
+            // pulls one event; the event and its views stay valid until the next call.
+            // returns nullptr after the stream end or on a parse error that
+            // couldn't be recovered from; see error().
+            event const* next();
+            // for pushed input, as much of it as was fed: parses the data and hands
+            // the handlers every event it completes, then returns without blocking.
+            // a parse cut off by the end of the data goes on with the next call;
+            // the data is only read during the call. false once there was a parse error.
+            // libyaml and the handlers run on a separate 1 MiB stack, where deep
+            // recursion or large locals fault on a guard page once it runs out;
+            // entering and leaving it costs a system call each per feed().
+            bool feed(char const* data, std::size_t size);
+            bool feed(std::string_view data);
+            // the pushed input is complete; hands over the remaining events
+            bool finish();
+            // false if the input had any parse error. next() and parse() take
+            // pushed input as finished.
+            bool parse();
+            // parses on a second thread while the handlers run on this one, with
+            // batches of events passed through a bounded single-producer ring
+            bool parse(pipeline_options const& options);
         private:
             class impl;
             std::unique_ptr<impl> _impl;
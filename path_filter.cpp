@@ -0,0 +1,276 @@
+#include "path_filter.h"
+#include <stdexcept>
+
+namespace yamlman
+{
+    namespace
+    {
+        std::size_t const npos= static_cast<std::size_t>(-1);
+
+        std::invalid_argument bad_selector(std::string_view path, char const* why)
+        {
+            return std::invalid_argument("selector '" + std::string(path) + "': " + why);
+        }
+    } // namespace
+
+    path_filter::path_filter() : _wildcards(false), _delivering(npos), _finished(0)
+    {
+    }
+
+    void path_filter::add(std::string_view path)
+    {
+        if(_selectors.size() == 64)
+        {
+            throw bad_selector(path, "no more than 64 selectors");
+        }
+
+        std::vector<step> steps;
+        std::size_t i= 0;
+
+        if(i < path.size() && path[i] == '$')
+        {
+            ++i;
+        }
+        while(i < path.size())
+        {
+            step s;
+
+            s.position= 0;
+            if(path[i] == '[')
+            {
+                ++i;
+                if(i < path.size() && path[i] == '*')
+                {
+                    s.kind= step::any_index;
+                    ++i;
+                }
+                else if(i < path.size() && (path[i] == '\'' || path[i] == '"'))
+                {
+                    std::size_t const close= path.find(path[i], i + 1);
+
+                    if(close == std::string_view::npos)
+                    {
+                        throw bad_selector(path, "unterminated quote");
+                    }
+                    s.kind= step::key;
+                    s.name= std::string(path.substr(i + 1, close - i - 1));
+                    i= close + 1;
+                }
+                else
+                {
+                    std::size_t const from= i;
+
+                    s.kind= step::index;
+                    for(; i < path.size() && path[i] >= '0' && path[i] <= '9'; ++i)
+                    {
+                        s.position= s.position * 10 + (path[i] - '0');
+                    }
+                    if(i == from)
+                    {
+                        throw bad_selector(path, "expected an index, * or a quoted key in []");
+                    }
+                }
+                if(i == path.size() || path[i] != ']')
+                {
+                    throw bad_selector(path, "expected ]");
+                }
+                ++i;
+            }
+            else
+            {
+                // the first name may go without its dot
+                if(path[i] == '.')
+                {
+                    ++i;
+                }
+                else if(i != 0)
+                {
+                    throw bad_selector(path, "expected . or [");
+                }
+
+                std::size_t const end= path.find_first_of(".[", i);
+                std::string_view const name= path.substr(i, end == std::string_view::npos ? std::string_view::npos : end - i);
+
+                if(name.empty())
+                {
+                    throw bad_selector(path, "empty key");
+                }
+                s.kind= name == "*" ? step::any_key : step::key;
+                s.name= std::string(name);
+                i+= name.size();
+            }
+            _wildcards= _wildcards || s.kind == step::any_key || s.kind == step::any_index;
+            steps.push_back(s);
+        }
+
+        _selectors.push_back(steps);
+    }
+
+    void path_filter::rewind()
+    {
+        _stack.clear();
+        _delivering= npos;
+        _finished= 0;
+    }
+
+    bool path_filter::accept(event_type type, std::string_view value)
+    {
+        switch(type)
+        {
+            case event_type::document_start:
+                _stack.clear();
+                _delivering= npos;
+                return true;
+            case event_type::scalar:
+            case event_type::alias:
+            {
+                std::size_t const depth= _stack.size();
+                std::uint64_t const active= begin_node(type == event_type::scalar ? &value : nullptr);
+                std::uint64_t const hit= active ? active & ending_at(depth) : 0;
+
+                _finished|= hit;
+
+                return _delivering != npos || hit;
+            }
+            case event_type::sequence_start:
+            case event_type::mapping_start:
+            {
+                std::size_t const depth= _stack.size();
+                std::uint64_t const active= begin_node(nullptr);
+                frame f;
+
+                f.mapping= type == event_type::mapping_start;
+                f.expect_key= true;
+                f.active= active;
+                f.child_active= 0;
+                f.hit= active ? active & ending_at(depth) : 0;
+                f.index= 0;
+                _stack.push_back(f);
+                if(f.hit && _delivering == npos)
+                {
+                    _delivering= depth;
+                }
+
+                return _delivering != npos;
+            }
+            case event_type::sequence_end:
+            case event_type::mapping_end:
+            {
+                if(_stack.empty())
+                {
+                    return true;
+                }
+
+                bool const res= _delivering != npos;
+
+                _finished|= _stack.back().hit;
+                _stack.pop_back();
+                if(_delivering == _stack.size())
+                {
+                    _delivering= npos;
+                }
+
+                return res;
+            }
+            case event_type::none:
+            case event_type::stream_start:
+            case event_type::stream_end:
+            case event_type::document_end:
+            default:
+                return true;
+        }
+    }
+
+    bool path_filter::done() const
+    {
+        std::uint64_t const all= _selectors.size() == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << _selectors.size()) - 1;
+
+        return !_selectors.empty() && !_wildcards && (_finished & all) == all;
+    }
+
+    // the selectors a node starting now is reached by; keys are never selected
+    // themselves but decide what their value is reached by
+    std::uint64_t path_filter::begin_node(std::string_view const* key_value)
+    {
+        if(_stack.empty())
+        {
+            return _selectors.size() == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << _selectors.size()) - 1;
+        }
+
+        frame& parent= _stack.back();
+        std::size_t const depth= _stack.size();
+
+        if(parent.mapping)
+        {
+            if(parent.expect_key)
+            {
+                parent.expect_key= false;
+                parent.child_active= parent.active ? match_key(parent.active, depth, key_value) : 0;
+                return 0;
+            }
+            parent.expect_key= true;
+            return parent.child_active;
+        }
+
+        std::uint64_t res= 0;
+
+        for(std::uint64_t rest= parent.active; rest; rest&= rest - 1)
+        {
+            unsigned const s= __builtin_ctzll(rest);
+            std::vector<step> const& steps= _selectors[s];
+
+            if(steps.size() >= depth)
+            {
+                step const& st= steps[depth - 1];
+
+                if(st.kind == step::any_index || (st.kind == step::index && st.position == parent.index))
+                {
+                    res|= std::uint64_t(1) << s;
+                }
+            }
+        }
+        ++parent.index;
+
+        return res;
+    }
+
+    // the selectors that end at a node of this depth
+    std::uint64_t path_filter::ending_at(std::size_t depth) const
+    {
+        std::uint64_t res= 0;
+
+        for(std::size_t s= 0; s < _selectors.size(); ++s)
+        {
+            if(_selectors[s].size() == depth)
+            {
+                res|= std::uint64_t(1) << s;
+            }
+        }
+
+        return res;
+    }
+
+    // collection and alias keys have no value to compare; only .* takes them
+    std::uint64_t path_filter::match_key(std::uint64_t active, std::size_t depth, std::string_view const* key_value) const
+    {
+        std::uint64_t res= 0;
+
+        for(std::uint64_t rest= active; rest; rest&= rest - 1)
+        {
+            unsigned const s= __builtin_ctzll(rest);
+            std::vector<step> const& steps= _selectors[s];
+
+            if(steps.size() >= depth)
+            {
+                step const& st= steps[depth - 1];
+
+                if(st.kind == step::any_key || (st.kind == step::key && key_value && *key_value == st.name))
+                {
+                    res|= std::uint64_t(1) << s;
+                }
+            }
+        }
+
+        return res;
+    }
+} // namespace yamlman
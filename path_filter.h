@@ -0,0 +1,78 @@
+#ifndef YAMLMAN_PATH_FILTER_H_
+#define YAMLMAN_PATH_FILTER_H_
+
+#include "event.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace yamlman
+{
+    // tracks where each event sits in its document and tells whether it lies
+    // in a subtree picked by one of the selectors. selectors are jsonpath-like:
+    //   a.b[*].c   $.a['b.c'][0]   *   $
+    // a leading $ is optional; .name and ['name'] step into a mapping value,
+    // .* into any of them, [n] into the sequence item n and [*] into any item.
+    // stream and document events are always accepted; the rest only inside
+    // a selected node, the node itself included.
+    class path_filter
+    {
+        public:
+            path_filter();
+        public:
+            // throws std::invalid_argument on a malformed selector, or past 64 selectors
+            void add(std::string_view path);
+            bool empty() const{ return _selectors.empty(); }
+            // starts over for a new stream, keeping the selectors
+            void rewind();
+            // feeds the next event in stream order; value is the scalar's for scalars.
+            // mapping keys are compared as their scalar value.
+            bool accept(event_type type, std::string_view value);
+            // with no wildcard in any selector, each matches one node at most;
+            // true once all of them have been delivered in full
+            bool done() const;
+        private:
+            struct step
+            {
+                enum kind_t
+                {
+                    key,
+                    any_key,
+                    index,
+                    any_index,
+                };
+
+                kind_t kind;
+                std::string name;
+                std::size_t position;
+            };
+
+            struct frame
+            {
+                bool mapping;
+                bool expect_key;
+                // selectors matching this collection's path so far
+                std::uint64_t active;
+                // selectors matching the value of the current key
+                std::uint64_t child_active;
+                // selectors that picked this collection
+                std::uint64_t hit;
+                std::size_t index;
+            };
+        private:
+            std::uint64_t begin_node(std::string_view const* key_value);
+            std::uint64_t ending_at(std::size_t depth) const;
+            std::uint64_t match_key(std::uint64_t active, std::size_t depth, std::string_view const* key_value) const;
+        private:
+            std::vector<std::vector<step>> _selectors;
+            bool _wildcards;
+            std::vector<frame> _stack;
+            // depth of the selected node being delivered; npos when none is
+            std::size_t _delivering;
+            std::uint64_t _finished;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_PATH_FILTER_H_
@@ -0,0 +1,292 @@
+#include "resolve.h"
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace yamlman
+{
+    namespace
+    {
+        enum class schema_tag
+        {
+            none,
+            null,
+            boolean,
+            integer,
+            floating,
+            string,
+        };
+
+        schema_tag classify_tag(std::string_view tag)
+        {
+            static std::string_view const prefix= "tag:yaml.org,2002:";
+
+            if(tag.empty())
+            {
+                return schema_tag::none;
+            }
+            if(tag.compare(0, prefix.size(), prefix) != 0)
+            {
+                return schema_tag::string;
+            }
+
+            std::string_view const name= tag.substr(prefix.size());
+
+            if(name == "null")
+            {
+                return schema_tag::null;
+            }
+            if(name == "bool")
+            {
+                return schema_tag::boolean;
+            }
+            if(name == "int")
+            {
+                return schema_tag::integer;
+            }
+            if(name == "float")
+            {
+                return schema_tag::floating;
+            }
+
+            return schema_tag::string;
+        }
+
+        bool is_null(std::string_view v)
+        {
+            return v.empty() || v == "~" || v == "null" || v == "Null" || v == "NULL";
+        }
+
+        bool to_bool(std::string_view v, bool& res)
+        {
+            if(v == "true" || v == "True" || v == "TRUE")
+            {
+                res= true;
+                return true;
+            }
+            if(v == "false" || v == "False" || v == "FALSE")
+            {
+                res= false;
+                return true;
+            }
+
+            return false;
+        }
+
+        bool is_digit(char c, int base)
+        {
+            switch(base)
+            {
+                case 8:
+                    return c >= '0' && c <= '7';
+                case 16:
+                    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+                default:
+                    return c >= '0' && c <= '9';
+            }
+        }
+
+        bool all_digits(std::string_view v, int base)
+        {
+            if(v.empty())
+            {
+                return false;
+            }
+            for(char const c : v)
+            {
+                if(!is_digit(c, base))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        enum class int_result
+        {
+            no,
+            yes,
+            overflow,
+        };
+
+        // from_chars takes neither a '+' nor the 0o/0x prefixes; they are checked and cut here
+        int_result to_int(std::string_view v, std::int64_t& res)
+        {
+            int base= 10;
+            bool negative= false;
+
+            if(v.size() > 2 && v[0] == '0' && (v[1] == 'o' || v[1] == 'x'))
+            {
+                base= v[1] == 'o' ? 8 : 16;
+                v.remove_prefix(2);
+            }
+            else if(!v.empty() && (v[0] == '-' || v[0] == '+'))
+            {
+                negative= v[0] == '-';
+                v.remove_prefix(1);
+            }
+            if(!all_digits(v, base))
+            {
+                return int_result::no;
+            }
+
+            // parsed as unsigned, so that the magnitude of INT64_MIN fits
+            std::uint64_t magnitude;
+            auto const r= std::from_chars(v.data(), v.data() + v.size(), magnitude, base);
+            std::uint64_t const limit= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + (negative ? 1 : 0);
+
+            if(r.ec == std::errc::result_out_of_range || magnitude > limit)
+            {
+                return base == 10 ? int_result::overflow : int_result::no;
+            }
+
+            res= negative ? static_cast<std::int64_t>(0 - magnitude) : static_cast<std::int64_t>(magnitude);
+
+            return int_result::yes;
+        }
+
+        bool to_float(std::string_view v, double& res)
+        {
+            bool negative= false;
+
+            if(v == ".nan" || v == ".NaN" || v == ".NAN")
+            {
+                res= std::numeric_limits<double>::quiet_NaN();
+                return true;
+            }
+            if(!v.empty() && (v[0] == '-' || v[0] == '+'))
+            {
+                negative= v[0] == '-';
+                v.remove_prefix(1);
+            }
+            if(v == ".inf" || v == ".Inf" || v == ".INF")
+            {
+                res= negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+                return true;
+            }
+
+            // the core schema grammar; from_chars alone would also take inf, nan and hex
+            std::size_t i= 0, digits= 0;
+
+            while(i < v.size() && is_digit(v[i], 10))
+            {
+                ++i;
+                ++digits;
+            }
+            if(i < v.size() && v[i] == '.')
+            {
+                ++i;
+                while(i < v.size() && is_digit(v[i], 10))
+                {
+                    ++i;
+                    ++digits;
+                }
+            }
+            if(!digits)
+            {
+                return false;
+            }
+            if(i < v.size() && (v[i] == 'e' || v[i] == 'E'))
+            {
+                ++i;
+                if(i < v.size() && (v[i] == '-' || v[i] == '+'))
+                {
+                    ++i;
+                }
+                if(i == v.size())
+                {
+                    return false;
+                }
+                while(i < v.size() && is_digit(v[i], 10))
+                {
+                    ++i;
+                }
+            }
+            if(i != v.size())
+            {
+                return false;
+            }
+
+#if defined(__cpp_lib_to_chars)
+            auto const r= std::from_chars(v.data(), v.data() + v.size(), res);
+
+            // out of range still leaves the text valid; it becomes +-inf or 0 like strtod
+            if(r.ec == std::errc::result_out_of_range)
+            {
+                res= std::strtod(std::string(v).c_str(), nullptr);
+            }
+#else
+            res= std::strtod(std::string(v).c_str(), nullptr);
+#endif
+            if(negative)
+            {
+                res= -res;
+            }
+
+            return true;
+        }
+    } // namespace
+
+    scalar_value resolve(std::string_view value, std::string_view tag, bool plain_implicit)
+    {
+        schema_tag const t= classify_tag(tag);
+
+        if(t == schema_tag::string || (t == schema_tag::none && !plain_implicit))
+        {
+            return value;
+        }
+
+        if((t == schema_tag::none || t == schema_tag::null) && is_null(value))
+        {
+            return nullptr;
+        }
+        if(t == schema_tag::none || t == schema_tag::boolean)
+        {
+            bool b;
+
+            if(to_bool(value, b))
+            {
+                return b;
+            }
+        }
+        if(t == schema_tag::none || t == schema_tag::integer || t == schema_tag::floating)
+        {
+            std::int64_t n;
+
+            switch(to_int(value, n))
+            {
+                case int_result::yes:
+                    if(t == schema_tag::floating)
+                    {
+                        return static_cast<double>(n);
+                    }
+                    return n;
+                case int_result::overflow:
+                    if(t != schema_tag::floating)
+                    {
+                        return big_integer{value};
+                    }
+                    break;
+                case int_result::no:
+                    if(t == schema_tag::integer)
+                    {
+                        return value;
+                    }
+                    break;
+            }
+        }
+        if(t == schema_tag::none || t == schema_tag::integer || t == schema_tag::floating)
+        {
+            double d;
+
+            if(to_float(value, d))
+            {
+                return d;
+            }
+        }
+
+        return value;
+    }
+} // namespace yamlman
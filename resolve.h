@@ -0,0 +1,42 @@
+#ifndef YAMLMAN_RESOLVE_H_
+#define YAMLMAN_RESOLVE_H_
+
+#include "event.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <variant>
+
+namespace yamlman
+{
+    // a decimal integer past int64_t, kept as written rather than rounded into a
+    // double; text views the event's value, sign included
+    struct big_integer
+    {
+        std::string_view text;
+    };
+
+    // a scalar as the yaml 1.2 core schema reads it; the string alternative
+    // views the event's value
+    typedef std::variant<std::nullptr_t, bool, std::int64_t, double, std::string_view, big_integer> scalar_value;
+
+    // resolves a scalar's text, only when called:
+    //   null    ~ null Null NULL and the empty scalar
+    //   bool    true True TRUE false False FALSE
+    //   int     [-+]?[0-9]+, 0o[0-7]+, 0x[0-9a-fA-F]+; decimals past int64_t are big_integer,
+    //           or doubles when tagged float
+    //   float   [-+]?(.[0-9]+|[0-9]+(.[0-9]*)?)([eE][-+]?[0-9]+)?, [-+]?.inf, .nan in the three cases
+    // a tag of tag:yaml.org,2002:null, bool, int or float forces that type, and
+    // tag:yaml.org,2002:str a string; a value that doesn't fit a forced type, any
+    // other tag and untagged scalars that aren't plain_implicit (quoted and block
+    // scalars) stay strings.
+    scalar_value resolve(std::string_view value, std::string_view tag, bool plain_implicit);
+
+    template<class String>
+    scalar_value resolve(basic_scalar_event<String> const& e)
+    {
+        return resolve(std::string_view(e.value()), std::string_view(e.tag()), e.plain_implicit());
+    }
+} // namespace yamlman
+
+#endif // YAMLMAN_RESOLVE_H_
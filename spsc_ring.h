@@ -0,0 +1,144 @@
+#ifndef YAMLMAN_SPSC_RING_H_
+#define YAMLMAN_SPSC_RING_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yamlman
+{
+    // bounded lock-free ring between exactly one producer and one consumer thread.
+    // slots are reused in place: the producer fills the slot from acquire() and
+    // publishes it, the consumer reads front() and releases it with pop().
+    // a side that finds the ring full or empty can wait for the other: it spins
+    // briefly, then sleeps until a publish(), pop() or close() wakes it.
+    template<class T>
+    class spsc_ring
+    {
+        public:
+            explicit spsc_ring(std::size_t capacity) : _slots(capacity ? capacity : 1), _head(0), _tail(0), _sleepers(0), _closed(false)
+            {
+            }
+            spsc_ring(spsc_ring const&)= delete;
+            spsc_ring& operator = (spsc_ring const&)= delete;
+        public:
+            // producer side; nullptr while the ring is full
+            T* acquire()
+            {
+                std::size_t const tail= _tail.load(std::memory_order_relaxed);
+
+                if(tail - _head.load(std::memory_order_acquire) == _slots.size())
+                {
+                    return nullptr;
+                }
+
+                return &_slots[tail % _slots.size()];
+            }
+
+            // nullptr once the ring is closed
+            T* wait_acquire()
+            {
+                return wait([this]{ return acquire(); });
+            }
+
+            void publish()
+            {
+                _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                wake();
+            }
+
+            // consumer side; nullptr while the ring is empty
+            T* front()
+            {
+                std::size_t const head= _head.load(std::memory_order_relaxed);
+
+                if(head == _tail.load(std::memory_order_acquire))
+                {
+                    return nullptr;
+                }
+
+                return &_slots[head % _slots.size()];
+            }
+
+            // nullptr once the ring is closed and drained
+            T* wait_front()
+            {
+                return wait([this]{ return front(); });
+            }
+
+            void pop()
+            {
+                _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                wake();
+            }
+
+            // either side; ends the other side's waits
+            void close()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+
+                    _closed= true;
+                }
+                _ready.notify_all();
+            }
+        private:
+            template<class Poll>
+            T* wait(Poll const& poll)
+            {
+                for(unsigned i= 0; i < 64; ++i)
+                {
+                    if(T* const slot= poll())
+                    {
+                        return slot;
+                    }
+                    if(_closed.load(std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+
+                std::unique_lock<std::mutex> lock(_mutex);
+                T* slot= nullptr;
+
+                // counted before polling again, so that a publish() or pop()
+                // either happens before the poll or sees the sleeper
+                _sleepers.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                _ready.wait(lock, [&]{
+                    return (slot= poll()) || _closed.load(std::memory_order_relaxed);
+                });
+                _sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+                return slot;
+            }
+
+            void wake()
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(_sleepers.load(std::memory_order_relaxed))
+                {
+                    // taking the lock orders the notify after the sleeper's last poll
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                    }
+                    _ready.notify_all();
+                }
+            }
+        private:
+            std::vector<T> _slots;
+            // on separate cache lines, so the two sides don't share one
+            alignas(64) std::atomic<std::size_t> _head;
+            alignas(64) std::atomic<std::size_t> _tail;
+            alignas(64) std::atomic<unsigned> _sleepers;
+            std::atomic<bool> _closed;
+            std::mutex _mutex;
+            std::condition_variable _ready;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_SPSC_RING_H_
@@ -0,0 +1,869 @@
+#include "subset_scanner.h"
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace yamlman
+{
+    namespace
+    {
+        // the characters the scanner looks up through bitmaps
+        enum kind
+        {
+            newline,
+            space,
+            colon,
+            hash,
+            quote,
+            kinds,
+        };
+
+        struct block_masks
+        {
+            std::uint64_t kinds[yamlman::kinds];
+        };
+
+        // sets bit i of each mask when p[i] is of that kind; returns the bytes
+        // libyaml rejects or the subset leaves out: control characters other
+        // than the newline (tabs and CR included), DEL and anything non-ascii
+        std::uint64_t classify(char const* p, block_masks& res)
+        {
+            std::uint64_t bad= 0, del= 0;
+
+            for(auto& m : res.kinds)
+            {
+                m= 0;
+            }
+#if defined(__AVX2__)
+            for(unsigned half= 0; half < 2; ++half)
+            {
+                __m256i const v= _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 32 * half));
+                auto const bits= [&](__m256i m){
+                    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(m))) << (32 * half);
+                };
+                auto const eq= [&](char c){
+                    return bits(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+                };
+
+                res.kinds[newline]|= eq('\n');
+                res.kinds[space]|= eq(' ');
+                res.kinds[colon]|= eq(':');
+                res.kinds[hash]|= eq('#');
+                res.kinds[quote]|= eq('"') | eq('\'');
+                // signed compare: bytes from 0x80 up are negative and fall in with the control characters
+                bad|= bits(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v));
+                del|= eq(0x7f);
+            }
+#elif defined(__SSE2__)
+            for(unsigned quarter= 0; quarter < 4; ++quarter)
+            {
+                __m128i const v= _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16 * quarter));
+                auto const bits= [&](__m128i m){
+                    return static_cast<std::uint64_t>(_mm_movemask_epi8(m)) << (16 * quarter);
+                };
+                auto const eq= [&](char c){
+                    return bits(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+                };
+
+                res.kinds[newline]|= eq('\n');
+                res.kinds[space]|= eq(' ');
+                res.kinds[colon]|= eq(':');
+                res.kinds[hash]|= eq('#');
+                res.kinds[quote]|= eq('"') | eq('\'');
+                // signed compare: bytes from 0x80 up are negative and fall in with the control characters
+                bad|= bits(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)));
+                del|= eq(0x7f);
+            }
+#else
+            for(unsigned i= 0; i < 64; ++i)
+            {
+                unsigned char const c= p[i];
+                std::uint64_t const bit= std::uint64_t(1) << i;
+
+                switch(c)
+                {
+                    case '\n':
+                        res.kinds[newline]|= bit;
+                        break;
+                    case ' ':
+                        res.kinds[space]|= bit;
+                        break;
+                    case ':':
+                        res.kinds[colon]|= bit;
+                        break;
+                    case '#':
+                        res.kinds[hash]|= bit;
+                        break;
+                    case '"':
+                    case '\'':
+                        res.kinds[quote]|= bit;
+                        break;
+                    default:
+                        break;
+                }
+                if(c < 0x20 || c >= 0x80)
+                {
+                    bad|= bit;
+                }
+                if(c == 0x7f)
+                {
+                    del|= bit;
+                }
+            }
+#endif
+            return (bad & ~res.kinds[newline]) | del;
+        }
+
+        // bitmaps for a window of the input at a time, so that the index of a
+        // large mapping stays in cache; the scanner moves forward through it
+        class structural_index
+        {
+            private:
+                static std::size_t const window= 1024;
+            public:
+                structural_index(char const* data, std::size_t size) : _data(data), _size(size), _blocks((size + 63) / 64), _first(0), _last(0), _indexed(0), _bad(false), _masks(window)
+                {
+                }
+            public:
+                // first position in [from, limit) holding a character of the kind; limit when there is none
+                std::size_t find(kind k, std::size_t from, std::size_t limit)
+                {
+                    for(std::size_t b= from / 64; b * 64 < limit; ++b)
+                    {
+                        std::uint64_t m= mask(k, b);
+
+                        if(b == from / 64)
+                        {
+                            m&= ~std::uint64_t(0) << (from % 64);
+                        }
+                        if(m)
+                        {
+                            std::size_t const pos= b * 64 + __builtin_ctzll(m);
+
+                            return pos < limit ? pos : limit;
+                        }
+                    }
+
+                    return limit;
+                }
+
+                // first position in [from, limit) that isn't a space
+                std::size_t skip_spaces(std::size_t from, std::size_t limit)
+                {
+                    for(std::size_t b= from / 64; b * 64 < limit; ++b)
+                    {
+                        std::uint64_t m= ~mask(space, b);
+
+                        if(b == from / 64)
+                        {
+                            m&= ~std::uint64_t(0) << (from % 64);
+                        }
+                        if(m)
+                        {
+                            std::size_t const pos= b * 64 + __builtin_ctzll(m);
+
+                            return pos < limit ? pos : limit;
+                        }
+                    }
+
+                    return limit;
+                }
+
+                // whether the whole input is free of characters outside the subset
+                bool clean()
+                {
+                    while(_indexed < _blocks)
+                    {
+                        index(_indexed);
+                    }
+
+                    return !_bad;
+                }
+            private:
+                std::uint64_t mask(kind k, std::size_t block)
+                {
+                    if(block < _first || block >= _last)
+                    {
+                        index(block);
+                    }
+
+                    return _masks[block - _first].kinds[k];
+                }
+
+                void index(std::size_t first)
+                {
+                    _first= first;
+                    _last= first + window < _blocks ? first + window : _blocks;
+                    for(std::size_t b= _first; b < _last; ++b)
+                    {
+                        std::uint64_t bad;
+
+                        if(b * 64 + 64 <= _size)
+                        {
+                            bad= classify(_data + b * 64, _masks[b - _first]);
+                        }
+                        else
+                        {
+                            // the tail, padded with spaces, which no lookup stops at
+                            char tail[64];
+
+                            std::memset(tail, ' ', sizeof(tail));
+                            std::memcpy(tail, _data + b * 64, _size - b * 64);
+                            bad= classify(tail, _masks[b - _first]);
+                        }
+                        _bad= _bad || bad;
+                    }
+                    if(_last > _indexed)
+                    {
+                        _indexed= _last;
+                    }
+                }
+            private:
+                char const* _data;
+                std::size_t _size;
+                std::size_t _blocks;
+                std::size_t _first, _last;
+                std::size_t _indexed;
+                bool _bad;
+                std::vector<block_masks> _masks;
+        };
+
+        // libyaml gives up on simple keys longer than this
+        std::size_t const max_simple_key= 1024;
+
+        // recursive descent over the lines, handing libyaml's events and marks to
+        // the sink. every method returning bool returns false when the input leaves the subset.
+        template<class Sink>
+        class subset_scanner
+        {
+            public:
+                subset_scanner(char const* data, std::size_t size, Sink& sink) : _data(data), _size(size), _index(data, size), _sink(sink), _pos(0), _line(0), _line_start(0)
+                {
+                }
+            public:
+                bool scan()
+                {
+                    bool after_end= false;
+
+                    {
+                        stream_start_event e= make<stream_start_event>(here(), here());
+
+                        e.encoding(encoding::utf8);
+                        _sink(e);
+                    }
+                    while(next_content())
+                    {
+                        if(at_marker('-'))
+                        {
+                            mark const start= here();
+
+                            _pos+= 3;
+                            if(!end_of_line())
+                            {
+                                return false;
+                            }
+                            document_start(start, here(), false);
+                        }
+                        else if(after_end || at_marker('.'))
+                        {
+                            return false;
+                        }
+                        else
+                        {
+                            document_start(here(), here(), true);
+                        }
+
+                        if(!next_content() || at_marker('-') || at_marker('.'))
+                        {
+                            empty_scalar(token_mark());
+                        }
+                        else if(!node(-1))
+                        {
+                            return false;
+                        }
+
+                        if(_pos < _size && at_marker('.'))
+                        {
+                            mark const start= here();
+
+                            _pos+= 3;
+                            if(!end_of_line())
+                            {
+                                return false;
+                            }
+                            document_end(start, here(), false);
+                            after_end= true;
+                        }
+                        else if(_pos < _size && !at_marker('-'))
+                        {
+                            // more content after the root node closed
+                            return false;
+                        }
+                        else
+                        {
+                            document_end(token_mark(), token_mark(), true);
+                            after_end= false;
+                        }
+                    }
+                    _sink(make<stream_end_event>(token_mark(), token_mark()));
+
+                    return _index.clean();
+                }
+            private:
+                // a node at the current position, inside a block collection at the given indent
+                bool node(long indent)
+                {
+                    if(at_entry())
+                    {
+                        return sequence(column(), false);
+                    }
+
+                    std::size_t const eol= end_of_line_pos();
+                    bool key;
+
+                    if(_data[_pos] == '"' || _data[_pos] == '\'')
+                    {
+                        std::size_t const close= closing_quote(eol);
+
+                        if(close == eol)
+                        {
+                            return false;
+                        }
+                        key= is_value_indicator(_index.skip_spaces(close + 1, eol));
+                    }
+                    else
+                    {
+                        if(!plain_start())
+                        {
+                            return false;
+                        }
+                        plain_end(eol, key);
+                    }
+
+                    return key ? mapping(column()) : scalar(indent);
+                }
+
+                bool mapping(std::size_t indent)
+                {
+                    {
+                        mapping_start_event e= make<mapping_start_event>(here(), here());
+
+                        e.implicit(true);
+                        e.style(collection_style::block);
+                        _sink(e);
+                    }
+                    for(;;)
+                    {
+                        if(at_entry() || !key())
+                        {
+                            return false;
+                        }
+
+                        // past the ':'
+                        ++_pos;
+
+                        mark const value_mark= here();
+                        std::size_t const eol= end_of_line_pos();
+                        std::size_t const p= _index.skip_spaces(_pos, eol);
+
+                        if(p == eol || _data[p] == '#')
+                        {
+                            if(p < eol && p == _pos)
+                            {
+                                return false;
+                            }
+                            if(!next_content() || at_marker('-') || at_marker('.') || column() < indent)
+                            {
+                                empty_scalar(value_mark);
+                            }
+                            else if(column() > indent)
+                            {
+                                if(!node(indent))
+                                {
+                                    return false;
+                                }
+                            }
+                            else if(at_entry())
+                            {
+                                if(!sequence(indent, true))
+                                {
+                                    return false;
+                                }
+                            }
+                            else
+                            {
+                                empty_scalar(value_mark);
+                            }
+                        }
+                        else
+                        {
+                            _pos= p;
+                            if(at_entry() || !scalar(indent))
+                            {
+                                return false;
+                            }
+                        }
+
+                        if(_pos == _size || at_marker('-') || at_marker('.') || column() < indent)
+                        {
+                            _sink(make<mapping_end_event>(token_mark(), token_mark()));
+                            return true;
+                        }
+                        if(column() > indent)
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                // indentless sequences are the values of mapping keys at the same indent
+                bool sequence(std::size_t indent, bool indentless)
+                {
+                    {
+                        mark const start= here();
+                        mark end= start;
+
+                        if(indentless)
+                        {
+                            end.column(end.column() + 1);
+                            end.index(end.index() + 1);
+                        }
+                        sequence_start_event e= make<sequence_start_event>(start, end);
+
+                        e.implicit(true);
+                        e.style(collection_style::block);
+                        _sink(e);
+                    }
+                    for(;;)
+                    {
+                        // past the '-'
+                        ++_pos;
+
+                        mark const item_mark= here();
+                        std::size_t const eol= end_of_line_pos();
+                        std::size_t const p= _index.skip_spaces(_pos, eol);
+
+                        if(p == eol || _data[p] == '#')
+                        {
+                            if(p < eol && p == _pos)
+                            {
+                                return false;
+                            }
+                            if(!next_content() || at_marker('-') || at_marker('.') || column() <= indent)
+                            {
+                                empty_scalar(item_mark);
+                            }
+                            else if(!node(indent))
+                            {
+                                return false;
+                            }
+                        }
+                        else
+                        {
+                            _pos= p;
+                            if(!node(indent))
+                            {
+                                return false;
+                            }
+                        }
+
+                        if(_pos == _size || at_marker('-') || at_marker('.') || column() < indent)
+                        {
+                            _sink(make<sequence_end_event>(token_mark(), token_mark()));
+                            return true;
+                        }
+                        if(column() > indent)
+                        {
+                            return false;
+                        }
+                        if(!at_entry())
+                        {
+                            if(!indentless)
+                            {
+                                return false;
+                            }
+                            _sink(make<sequence_end_event>(token_mark(), token_mark()));
+                            return true;
+                        }
+                    }
+                }
+
+                // a mapping key up to its ':'
+                bool key()
+                {
+                    std::size_t const eol= end_of_line_pos();
+                    std::size_t const start= _pos;
+
+                    if(_data[_pos] == '"' || _data[_pos] == '\'')
+                    {
+                        std::size_t const close= closing_quote(eol);
+
+                        if(close == eol)
+                        {
+                            return false;
+                        }
+                        quoted_scalar(close);
+                        _pos= _index.skip_spaces(_pos, eol);
+                    }
+                    else
+                    {
+                        bool key;
+
+                        if(!plain_start())
+                        {
+                            return false;
+                        }
+
+                        std::size_t const end= plain_end(eol, key);
+
+                        if(!key)
+                        {
+                            return false;
+                        }
+                        plain_scalar(end);
+                        _pos= _index.skip_spaces(_pos, eol);
+                    }
+
+                    return is_value_indicator(_pos) && _pos - start <= max_simple_key;
+                }
+
+                // a scalar as a value; it has to end its line, and the next line
+                // must not be indented past the enclosing collection
+                bool scalar(long indent)
+                {
+                    std::size_t const eol= end_of_line_pos();
+
+                    if(_data[_pos] == '"' || _data[_pos] == '\'')
+                    {
+                        std::size_t const close= closing_quote(eol);
+
+                        if(close == eol)
+                        {
+                            return false;
+                        }
+                        quoted_scalar(close);
+                    }
+                    else
+                    {
+                        bool key;
+
+                        if(!plain_start())
+                        {
+                            return false;
+                        }
+
+                        std::size_t const end= plain_end(eol, key);
+
+                        if(key)
+                        {
+                            return false;
+                        }
+                        plain_scalar(end);
+                    }
+                    if(!end_of_line())
+                    {
+                        return false;
+                    }
+
+                    // a deeper line would continue a multi-line scalar
+                    return !next_content() || at_marker('-') || at_marker('.') || static_cast<long>(column()) <= indent;
+                }
+
+                void plain_scalar(std::size_t end)
+                {
+                    scalar_event e= make<scalar_event>(here(), mark_at(end));
+
+                    e.value(std::string_view(_data + _pos, end - _pos));
+                    e.style(scalar_style::plain);
+                    e.plain_implicit(true);
+                    e.quoted_implicit(false);
+                    _sink(e);
+                    _pos= end;
+                }
+
+                void quoted_scalar(std::size_t close)
+                {
+                    scalar_event e= make<scalar_event>(here(), mark_at(close + 1));
+
+                    e.value(std::string_view(_data + _pos + 1, close - _pos - 1));
+                    e.style(_data[_pos] == '"' ? scalar_style::double_quoted : scalar_style::single_quoted);
+                    e.plain_implicit(false);
+                    e.quoted_implicit(true);
+                    _sink(e);
+                    _pos= close + 1;
+                }
+
+                void empty_scalar(mark const& at)
+                {
+                    scalar_event e= make<scalar_event>(at, at);
+
+                    e.value(std::string_view(_data + at.index(), 0));
+                    e.style(scalar_style::plain);
+                    e.plain_implicit(true);
+                    e.quoted_implicit(false);
+                    _sink(e);
+                }
+
+                // the closing quote on this line, or eol; eol too when the scalar
+                // has escapes, which would need a copy
+                std::size_t closing_quote(std::size_t eol)
+                {
+                    char const q= _data[_pos];
+
+                    for(std::size_t p= _index.find(quote, _pos + 1, eol); p < eol; p= _index.find(quote, p + 1, eol))
+                    {
+                        if(_data[p] != q)
+                        {
+                            continue;
+                        }
+                        if(q == '"' && std::memchr(_data + _pos + 1, '\\', p - _pos - 1))
+                        {
+                            return eol;
+                        }
+                        if(q == '\'' && p + 1 < eol && _data[p + 1] == '\'')
+                        {
+                            return eol;
+                        }
+                        return p;
+                    }
+
+                    return eol;
+                }
+
+                // the end of a plain scalar starting here, without trailing spaces;
+                // key tells whether a ':' ends it rather than a comment or the line
+                std::size_t plain_end(std::size_t eol, bool& key)
+                {
+                    std::size_t end= eol;
+
+                    key= false;
+                    for(std::size_t p= _index.find(colon, _pos, eol); p < eol; p= _index.find(colon, p + 1, eol))
+                    {
+                        if(is_value_indicator(p))
+                        {
+                            end= p;
+                            key= true;
+                            break;
+                        }
+                    }
+                    for(std::size_t p= _index.find(hash, _pos, end); p < end; p= _index.find(hash, p + 1, end))
+                    {
+                        if(_data[p - 1] == ' ')
+                        {
+                            end= p;
+                            key= false;
+                            break;
+                        }
+                    }
+                    while(end > _pos && _data[end - 1] == ' ')
+                    {
+                        --end;
+                    }
+
+                    return end;
+                }
+
+                // plain scalars can't start with an indicator; the subset doesn't
+                // support those constructs either
+                bool plain_start() const
+                {
+                    switch(_data[_pos])
+                    {
+                        case '-':
+                        case '?':
+                        case ':':
+                            return _pos + 1 < _size && _data[_pos + 1] != ' ' && _data[_pos + 1] != '\n';
+                        case ',':
+                        case '[':
+                        case ']':
+                        case '{':
+                        case '}':
+                        case '#':
+                        case '&':
+                        case '*':
+                        case '!':
+                        case '|':
+                        case '>':
+                        case '%':
+                        case '@':
+                        case '`':
+                            return false;
+                        default:
+                            return true;
+                    }
+                }
+
+                bool is_value_indicator(std::size_t p) const
+                {
+                    return p < _size && _data[p] == ':' && (p + 1 == _size || _data[p + 1] == ' ' || _data[p + 1] == '\n');
+                }
+
+                bool at_entry() const
+                {
+                    return _data[_pos] == '-' && (_pos + 1 == _size || _data[_pos + 1] == ' ' || _data[_pos + 1] == '\n');
+                }
+
+                // --- or ... at the start of a line
+                bool at_marker(char c) const
+                {
+                    return _pos == _line_start && _pos + 3 <= _size && _data[_pos] == c && _data[_pos + 1] == c && _data[_pos + 2] == c
+                        && (_pos + 3 == _size || _data[_pos + 3] == ' ' || _data[_pos + 3] == '\n');
+                }
+
+                // nothing but spaces and a comment left on the line
+                bool end_of_line()
+                {
+                    std::size_t const eol= end_of_line_pos();
+                    std::size_t const p= _index.skip_spaces(_pos, eol);
+
+                    return p == eol || (_data[p] == '#' && p > _pos);
+                }
+
+                std::size_t end_of_line_pos()
+                {
+                    return _index.find(newline, _pos, _size);
+                }
+
+                // moves to the next character that isn't a space, a newline or in a comment
+                bool next_content()
+                {
+                    for(;;)
+                    {
+                        _pos= _index.skip_spaces(_pos, _size);
+                        if(_pos == _size)
+                        {
+                            return false;
+                        }
+                        switch(_data[_pos])
+                        {
+                            case '\n':
+                                ++_pos;
+                                ++_line;
+                                _line_start= _pos;
+                                break;
+                            case '#':
+                                _pos= end_of_line_pos();
+                                break;
+                            default:
+                                return true;
+                        }
+                    }
+                }
+
+                std::size_t column() const
+                {
+                    return _pos - _line_start;
+                }
+
+                mark here() const
+                {
+                    return mark_at(_pos);
+                }
+
+                // a position on the current line; the input is ascii, so the
+                // character index is the byte offset
+                mark mark_at(std::size_t pos) const
+                {
+                    mark res;
+
+                    res.line(_line);
+                    res.column(pos - _line_start);
+                    res.index(pos);
+
+                    return res;
+                }
+
+                // where libyaml puts the next token; at the end, a final line
+                // without a newline counts as ended
+                mark token_mark() const
+                {
+                    mark res= here();
+
+                    if(_pos == _size && res.column() != 0)
+                    {
+                        res.line(res.line() + 1);
+                        res.column(0);
+                    }
+
+                    return res;
+                }
+
+                void document_start(mark const& start, mark const& end, bool implicit)
+                {
+                    document_start_event e= make<document_start_event>(start, end);
+
+                    e.implicit(implicit);
+                    _sink(e);
+                }
+
+                void document_end(mark const& start, mark const& end, bool implicit)
+                {
+                    document_end_event e= make<document_end_event>(start, end);
+
+                    e.implicit(implicit);
+                    _sink(e);
+                }
+
+                template<class Event>
+                static Event make(mark const& start, mark const& end)
+                {
+                    Event e= Event();
+
+                    e.start_mark(start);
+                    e.end_mark(end);
+
+                    return e;
+                }
+            private:
+                char const* _data;
+                std::size_t _size;
+                structural_index _index;
+                Sink& _sink;
+                std::size_t _pos;
+                std::size_t _line;
+                std::size_t _line_start;
+        };
+    } // namespace
+
+    bool scan_subset(char const* data, std::size_t size, std::vector<event>& events)
+    {
+        auto sink= [&events](auto const& e){
+            events.emplace_back();
+            events.back().reset<std::decay_t<decltype(e)>>()= e;
+        };
+
+        events.clear();
+
+        return subset_scanner<decltype(sink)>(data, size, sink).scan();
+    }
+
+    bool scan_subset(char const* data, std::size_t size, std::function<void(event const&)> const& handler)
+    {
+        // the first pass only validates, so that nothing reaches the handler
+        // from an input that turns out to need libyaml
+        {
+            auto sink= [](auto const&){};
+
+            if(!subset_scanner<decltype(sink)>(data, size, sink).scan())
+            {
+                return false;
+            }
+        }
+
+        event current;
+        auto sink= [&](auto const& e){
+            current.reset<std::decay_t<decltype(e)>>()= e;
+            handler(current);
+        };
+
+        subset_scanner<decltype(sink)>(data, size, sink).scan();
+
+        return true;
+    }
+} // namespace yamlman
@@ -0,0 +1,29 @@
+#ifndef YAMLMAN_SUBSET_SCANNER_H_
+#define YAMLMAN_SUBSET_SCANNER_H_
+
+#include "event.h"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace yamlman
+{
+    // scans the block subset of yaml most generated files stay in: block mappings
+    // and sequences of single-line plain, single- or double-quoted scalars without
+    // escapes, in printable ascii without tabs or CR. comments and --- / ... markers
+    // are handled.
+    // newlines, spaces, colons, hashes and quotes are found through bitmaps built
+    // 64 bytes at a time with SSE2 or AVX2, rather than character by character.
+    //
+    // on success, events holds the same events libyaml produces for the input,
+    // marks included, with views into data. returns false as soon as the input
+    // leaves the subset (anchors, tags, flow collections, block scalars, multi-line
+    // scalars, directives, malformed input, ...); the input then needs libyaml.
+    bool scan_subset(char const* data, std::size_t size, std::vector<event>& events);
+    // the same without storing the events; the handler gets each event in turn,
+    // valid for the call. the input is scanned twice, to check that it is within
+    // the subset before the first event goes out.
+    bool scan_subset(char const* data, std::size_t size, std::function<void(event const&)> const& handler);
+} // namespace yamlman
+
+#endif // YAMLMAN_SUBSET_SCANNER_H_
@@ -0,0 +1,93 @@
+#include "symbol_table.h"
+
+namespace yamlman
+{
+    namespace
+    {
+        template<class Event>
+        void intern_anchor(symbol_table& table, Event& e)
+        {
+            symbol const id= table.intern(e.anchor());
+
+            e.anchor_id(id);
+            e.anchor(table.name(id));
+        }
+
+        template<class Event>
+        void intern_tag(symbol_table& table, Event& e)
+        {
+            symbol const id= table.intern(e.tag());
+
+            e.tag_id(id);
+            e.tag(table.name(id));
+        }
+    } // namespace
+
+    // tags and anchors are few and short; no need for the arena's usual blocks
+    symbol_table::symbol_table() : _strings(4096), _names(1)
+    {
+    }
+
+    symbol symbol_table::intern(std::string_view s)
+    {
+        if(s.empty())
+        {
+            return 0;
+        }
+
+        auto const it= _ids.find(s);
+
+        if(it != _ids.end())
+        {
+            return it->second;
+        }
+
+        std::string_view const name= _strings.copy(s);
+        symbol const id= static_cast<symbol>(_names.size());
+
+        _names.push_back(name);
+        _ids.emplace(name, id);
+
+        return id;
+    }
+
+    void symbol_table::intern(event& e)
+    {
+        switch(e.type())
+        {
+            case event_type::alias:
+                intern_anchor(*this, e.reset<alias_event>());
+                break;
+            case event_type::scalar:{
+                scalar_event& ev= e.reset<scalar_event>();
+
+                intern_anchor(*this, ev);
+                intern_tag(*this, ev);
+                break;
+            }
+            case event_type::sequence_start:{
+                sequence_start_event& ev= e.reset<sequence_start_event>();
+
+                intern_anchor(*this, ev);
+                intern_tag(*this, ev);
+                break;
+            }
+            case event_type::mapping_start:{
+                mapping_start_event& ev= e.reset<mapping_start_event>();
+
+                intern_anchor(*this, ev);
+                intern_tag(*this, ev);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void symbol_table::clear()
+    {
+        _ids.clear();
+        _names.resize(1);
+        _strings.clear();
+    }
+} // namespace yamlman
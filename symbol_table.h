@@ -0,0 +1,40 @@
+#ifndef YAMLMAN_SYMBOL_TABLE_H_
+#define YAMLMAN_SYMBOL_TABLE_H_
+
+#include "event.h"
+#include "arena.h"
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace yamlman
+{
+    // interns tags and anchors: each distinct string is copied once and given a
+    // small id, so handlers compare ids instead of strings and may keep the
+    // views past their event. ids count from 1 in order of first sight; the
+    // empty string is 0. ids and views stay valid until clear().
+    //   symbol_table symbols;
+    //   symbol const str= symbols.intern("tag:yaml.org,2002:str");
+    //   parser.symbols(&symbols).on_scalar([&](scalar_event const& e){ if(e.tag_id() == str) ... });
+    class symbol_table
+    {
+        public:
+            symbol_table();
+        public:
+            // the id of s, added on first sight
+            symbol intern(std::string_view s);
+            // points e's anchor and tag at the table's copies and sets their ids
+            void intern(event& e);
+            std::string_view name(symbol id) const{ return _names[id]; }
+            // symbols so far, the empty one included
+            std::size_t size() const{ return _names.size(); }
+            void clear();
+        private:
+            arena _strings;
+            std::vector<std::string_view> _names;
+            std::unordered_map<std::string_view, symbol> _ids;
+    };
+} // namespace yamlman
+
+#endif // YAMLMAN_SYMBOL_TABLE_H_
@@ -0,0 +1,123 @@
+#include "../document.h"
+#include "../parser.h"
+#include <cstdio>
+#include <string>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            ++failures;
+        }
+    }
+
+    // the classic: each level is ten aliases of the one before, so a full
+    // traversal visits 10^levels scalars while the input stays tiny
+    std::string laughs(unsigned levels)
+    {
+        std::string s= "a0: &a0 lol\n";
+
+        for(unsigned i= 1; i <= levels; ++i)
+        {
+            s+= "a" + std::to_string(i) + ": &a" + std::to_string(i) + " [";
+            for(unsigned j= 0; j < 10; ++j)
+            {
+                s+= (j ? ", *a" : "*a") + std::to_string(i - 1);
+            }
+            s+= "]\n";
+        }
+        return s;
+    }
+
+    // loads the first document, returning the document_error's message or "" on success
+    std::string load(std::string const& input, yamlman::alias_limits const& limits)
+    {
+        yamlman::parser parser(input);
+        yamlman::document doc(limits);
+
+        try
+        {
+            check(doc.load(parser), "no document loaded");
+        }
+        catch(yamlman::document_error const& e)
+        {
+            return e.what();
+        }
+        return std::string();
+    }
+
+    bool mentions(std::string const& what, char const* part)
+    {
+        return what.find(part) != std::string::npos;
+    }
+
+    void billion_laughs()
+    {
+        std::string const input= laughs(9);
+
+        check(input.size() < 1024, "the laughs input isn't small");
+        check(mentions(load(input, yamlman::alias_limits()), "expansion"), "billion laughs got past max_expansion");
+
+        yamlman::alias_limits wide;
+
+        wide.max_expansion= static_cast<std::size_t>(-1);
+        check(load(input, wide).empty(), "billion laughs was rejected past max_expansion");
+
+        // three levels expand to ~1100 nodes, well inside the defaults, and share the subtrees
+        check(load(laughs(3), yamlman::alias_limits()).empty(), "a small laughs input was rejected");
+
+        yamlman::alias_limits tight;
+
+        tight.max_expansion= 100;
+        check(mentions(load(laughs(3), tight), "expansion"), "max_expansion isn't honoured");
+    }
+
+    void alias_count()
+    {
+        yamlman::alias_limits limits;
+
+        limits.max_aliases= 9;
+        check(mentions(load(laughs(1), limits), "too many aliases"), "max_aliases isn't honoured");
+        limits.max_aliases= 10;
+        check(load(laughs(1), limits).empty(), "max_aliases rejects exactly the limit");
+    }
+
+    void alias_depth()
+    {
+        yamlman::alias_limits limits;
+
+        limits.max_depth= 3;
+        check(load(laughs(3), limits).empty(), "max_depth rejects exactly the limit");
+        check(mentions(load(laughs(4), limits), "too deep"), "max_depth isn't honoured");
+    }
+
+    void shared_subtrees()
+    {
+        std::string const input= laughs(2);
+        yamlman::parser parser(input);
+        yamlman::document doc;
+
+        check(doc.load(parser), "no document loaded");
+
+        yamlman::node const* a1= doc.root().find("a1");
+        yamlman::node const* a2= doc.root().find("a2");
+
+        check(a1 && a2 && a2->size() == 10, "laughs(2) has the wrong shape");
+        check(a2 && a2->item(0).target() == a1 && a2->item(9).target() == a1, "aliases aren't shared with their anchor");
+    }
+} // namespace
+
+int main()
+{
+    billion_laughs();
+    alias_count();
+    alias_depth();
+    shared_subtrees();
+
+    return failures ? 1 : 0;
+}
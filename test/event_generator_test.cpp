@@ -0,0 +1,167 @@
+#include "../event_generator.h"
+#include <algorithm>
+#include <coroutine>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            ++failures;
+        }
+    }
+
+    std::string describe(yamlman::event const& e)
+    {
+        std::string s= std::to_string(static_cast<int>(e.type()));
+
+        if(e.type() == yamlman::event_type::scalar)
+        {
+            s+= ' ';
+            s+= e.get<yamlman::scalar_event>().value();
+        }
+        return s;
+    }
+
+    std::vector<std::string> pulled(std::string_view input)
+    {
+        yamlman::parser parser(input);
+        std::vector<std::string> events;
+
+        while(yamlman::event const* e= parser.next())
+        {
+            events.push_back(describe(*e));
+        }
+        return events;
+    }
+
+    std::string const good= "a: [1, 2, {b: c}]\n--- x\n";
+    std::string const bad= "a: [1, 2\nb: c\n";
+
+    void generator()
+    {
+        {
+            yamlman::parser parser(good);
+            std::vector<std::string> events;
+
+            for(yamlman::event const& e : yamlman::events(parser))
+            {
+                events.push_back(describe(e));
+            }
+            check(events == pulled(good), "events() differs from next()");
+        }
+        {
+            yamlman::parser parser(bad);
+            std::vector<std::string> events;
+            bool thrown= false;
+
+            try
+            {
+                for(yamlman::event const& e : yamlman::events(parser))
+                {
+                    events.push_back(describe(e));
+                }
+            }
+            catch(yamlman::parse_error const&)
+            {
+                thrown= true;
+            }
+            check(thrown, "events() didn't throw the parse_error");
+            check(events == pulled(bad), "events() before the error differ from next()");
+        }
+        {
+            // leaving the loop early destroys the suspended coroutine
+            yamlman::parser parser(good);
+            std::size_t n= 0;
+
+            for(yamlman::event const& e : yamlman::events(parser))
+            {
+                if(++n == 3 || e.type() == yamlman::event_type::stream_end)
+                {
+                    break;
+                }
+            }
+            check(n == 3, "breaking out of events() misbehaved");
+        }
+    }
+
+    // a source whose chunks are always ready, so that the whole exchange
+    // runs inside the consumer's first resumption
+    struct ready
+    {
+        std::string_view chunk;
+
+        bool await_ready() const noexcept{ return true; }
+        void await_suspend(std::coroutine_handle<>) const noexcept{}
+        std::string_view await_resume() const noexcept{ return chunk; }
+    };
+
+    // a fire-and-forget coroutine for the consumer side
+    struct task
+    {
+        struct promise_type
+        {
+            task get_return_object(){ return task(); }
+            std::suspend_never initial_suspend() noexcept{ return {}; }
+            std::suspend_never final_suspend() noexcept{ return {}; }
+            void return_void(){}
+            void unhandled_exception(){ std::terminate(); }
+        };
+    };
+
+    task consume(std::string_view input, std::size_t chunk, std::vector<std::string>& events, bool& thrown)
+    {
+        std::size_t from= 0;
+        yamlman::async_event_generator gen= yamlman::async_events([&]{
+            std::string_view const c= input.substr(std::min(from, input.size()), chunk);
+
+            from+= chunk;
+            return ready{c};
+        });
+
+        try
+        {
+            while(yamlman::event const* e= co_await gen.next())
+            {
+                events.push_back(describe(*e));
+            }
+        }
+        catch(yamlman::parse_error const&)
+        {
+            thrown= true;
+        }
+    }
+
+    void async_generator()
+    {
+        for(std::size_t chunk : {1, 5, 4096})
+        {
+            std::vector<std::string> events;
+            bool thrown= false;
+
+            consume(good, chunk, events, thrown);
+            check(!thrown && events == pulled(good), "async_events() differs from next()");
+
+            events.clear();
+            consume(bad, chunk, events, thrown);
+            check(thrown, "async_events() didn't throw the parse_error");
+            check(events == pulled(bad), "async_events() before the error differ from next()");
+        }
+    }
+} // namespace
+
+int main()
+{
+    generator();
+    async_generator();
+
+    return failures ? 1 : 0;
+}
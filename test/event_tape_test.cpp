@@ -0,0 +1,265 @@
+#include "../event_tape.h"
+#include "../line_index.h"
+#include "../parser.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            ++failures;
+        }
+    }
+
+    std::string describe(yamlman::event const& e)
+    {
+        yamlman::mark const start= e.base()->start_mark();
+        yamlman::mark const end= e.base()->end_mark();
+        std::string s= std::to_string(static_cast<int>(e.type()));
+
+        s+= " " + std::to_string(start.index()) + ":" + std::to_string(start.line()) + ":" + std::to_string(start.column());
+        s+= " " + std::to_string(end.index()) + ":" + std::to_string(end.line()) + ":" + std::to_string(end.column());
+        if(e.type() == yamlman::event_type::scalar)
+        {
+            yamlman::scalar_event const& ev= e.get<yamlman::scalar_event>();
+
+            s+= " ";
+            s+= ev.anchor();
+            s+= " ";
+            s+= ev.tag();
+            s+= " ";
+            s+= ev.value();
+            s+= " " + std::to_string(static_cast<int>(ev.style()));
+        }
+        return s;
+    }
+
+    std::string record(std::string const& input, std::vector<std::string>& events)
+    {
+        yamlman::tape_writer writer;
+        std::ostringstream tape;
+
+        yamlman::parser(input).on_event([&](yamlman::event const& e){
+            events.push_back(describe(e));
+            writer.add(e);
+        }).parse();
+        writer.write(tape, yamlman::source_hash(input.data(), input.size()));
+
+        return tape.str();
+    }
+
+    std::vector<std::string> replay(yamlman::tape_reader const& reader)
+    {
+        std::vector<std::string> events;
+
+        yamlman::parser(reader).on_event([&](yamlman::event const& e){ events.push_back(describe(e)); }).parse();
+
+        return events;
+    }
+
+    bool rejected(std::string const& tape)
+    {
+        try
+        {
+            yamlman::tape_reader reader(tape.data(), tape.size());
+        }
+        catch(yamlman::tape_error const&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    template<class Int>
+    void poke(std::string& tape, std::size_t at, Int val)
+    {
+        std::memcpy(&tape[at], &val, sizeof(val));
+    }
+
+    std::string const input= "\xef\xbb\xbf" "a: &x \xc3\xa9t\xc3\xa9\r\nb:\n  - !t [1, 'two']\n  - |\n    x\n    y\n--- *x\n";
+
+    // with the source's line_index the marks are those of the parse; without
+    // it, only their indices
+    void round_trip()
+    {
+        std::vector<std::string> expected;
+        std::string const tape= record(input, expected);
+        yamlman::tape_reader reader(tape.data(), tape.size());
+        yamlman::line_index lines(input.data(), input.size());
+
+        check(reader.valid_for(input.data(), input.size()), "the tape isn't valid for its source");
+        check(!reader.valid_for(input.data(), input.size() - 1), "the tape is valid for another source");
+        check(reader.size() == expected.size(), "the tape has the wrong number of events");
+        // a 40 byte header and 32 byte records
+        check(tape.size() < 40 + 32 * expected.size() + input.size(), "the tape isn't narrow");
+
+        reader.lines(&lines);
+        check(replay(reader) == expected, "the tape replays differently from the parse");
+
+        reader.lines(nullptr);
+
+        yamlman::event e;
+
+        reader.get(3, e);
+        check(e.base()->start_mark().line() == 0 && e.base()->start_mark().column() == 0 && e.base()->end_mark().index() != 0, "marks without a line_index aren't index only");
+    }
+
+    // a value past 32 bits makes the whole tape wide, the records before it included
+    void wide()
+    {
+        yamlman::tape_writer writer;
+        yamlman::event e;
+        yamlman::mark m;
+        std::uint64_t const far= std::uint64_t(5) << 30;
+
+        m.line(0);
+        m.column(0);
+        for(std::uint64_t i= 0; i < 3; ++i)
+        {
+            yamlman::scalar_event& s= e.reset<yamlman::scalar_event>();
+
+            m.index(i ? far + i : i);
+            s.start_mark(m);
+            s.end_mark(m);
+            s.anchor("");
+            s.tag("");
+            s.value(i == 1 ? "one" : "other");
+            writer.add(e);
+        }
+
+        std::ostringstream out;
+
+        writer.write(out, 0);
+
+        std::string const tape= out.str();
+        yamlman::tape_reader reader(tape.data(), tape.size());
+
+        check(tape.size() == 40 + 3 * 56 + 13, "a far index didn't widen the tape");
+        reader.get(0, e);
+        check(e.base()->start_mark().index() == 0 && e.get<yamlman::scalar_event>().value() == "other", "the first record was widened wrong");
+        reader.get(1, e);
+        check(e.base()->end_mark().index() == far + 1 && e.get<yamlman::scalar_event>().value() == "one", "a far index was cut short");
+    }
+
+    // every damage is caught when the reader is constructed, not in get()
+    void damaged()
+    {
+        std::vector<std::string> events;
+        std::string const tape= record(input, events);
+        std::size_t const records= 40;
+        std::size_t const pool= records + events.size() * 32;
+
+        check(!rejected(tape), "a good tape was rejected");
+        for(std::size_t size= 0; size < tape.size(); ++size)
+        {
+            if(!rejected(tape.substr(0, size)))
+            {
+                check(false, "a truncated tape was taken");
+                break;
+            }
+        }
+        check(rejected(tape + "x"), "a tape with trailing bytes was taken");
+
+        std::string bad= tape;
+
+        bad[0]= 'Y';
+        check(rejected(bad), "a bad magic was taken");
+        bad= tape;
+        poke<std::uint32_t>(bad, 8, 3);
+        check(rejected(bad), "a version 3 tape was taken");
+        bad= tape;
+        poke<std::uint32_t>(bad, 12, 80);
+        check(rejected(bad), "an unknown record size was taken");
+        bad= tape;
+        poke<std::uint64_t>(bad, 24, ~std::uint64_t(0) / 32);
+        check(rejected(bad), "a count past the tape was taken");
+
+        // the fourth record is the scalar 'a'
+        std::size_t const scalar= records + 3 * 32;
+
+        bad= tape;
+        bad[scalar]= 11;
+        check(rejected(bad), "an unknown event kind was taken");
+        bad= tape;
+        bad[scalar + 1]= 6;
+        check(rejected(bad), "an unknown scalar style was taken");
+        bad= tape;
+        bad[records + 1]= 4;
+        check(rejected(bad), "an unknown encoding was taken");
+        bad= tape;
+        // the document start has no style
+        bad[records + 32 + 1]= 1;
+        check(rejected(bad), "a style on a document start was taken");
+        bad= tape;
+        poke<std::uint32_t>(bad, scalar + 28, static_cast<std::uint32_t>(tape.size() - pool + 1));
+        check(rejected(bad), "an offset past the pool was taken");
+        bad= tape;
+        poke<std::uint32_t>(bad, scalar + 24, static_cast<std::uint32_t>(tape.size() - pool + 1));
+        check(rejected(bad), "a value past the pool was taken");
+        bad= tape;
+        poke<std::uint32_t>(bad, scalar + 16, ~std::uint32_t(0));
+        check(rejected(bad), "an anchor past the pool was taken");
+    }
+
+    // lengths that wrap around when added up still have to fit one at a time
+    void wrapped()
+    {
+        yamlman::tape_writer writer;
+        yamlman::event e;
+        yamlman::mark m;
+
+        m.line(0);
+        m.column(0);
+        m.index(std::uint64_t(1) << 33);
+
+        yamlman::scalar_event& s= e.reset<yamlman::scalar_event>();
+
+        s.start_mark(m);
+        s.end_mark(m);
+        s.anchor("a");
+        s.tag("");
+        s.value("bc");
+        writer.add(e);
+
+        std::ostringstream out;
+
+        writer.write(out, 0);
+
+        std::string const tape= out.str();
+        std::size_t const scalar= 40;
+        std::string bad= tape;
+
+        check(!rejected(tape), "a good wide tape was rejected");
+        // anchor 2, tag 2^64 - 1: two past the pool, or one once wrapped
+        poke<std::uint64_t>(bad, scalar + 24, 2);
+        poke<std::uint64_t>(bad, scalar + 32, ~std::uint64_t(0));
+        poke<std::uint64_t>(bad, scalar + 40, 0);
+        check(rejected(bad), "an anchor and tag wrapping around were taken");
+        bad= tape;
+        poke<std::uint64_t>(bad, scalar + 40, ~std::uint64_t(0) - 1);
+        check(rejected(bad), "a value wrapping around was taken");
+        bad= tape;
+        poke<std::uint64_t>(bad, scalar + 48, ~std::uint64_t(0));
+        check(rejected(bad), "an offset wrapping around was taken");
+    }
+} // namespace
+
+int main()
+{
+    round_trip();
+    wide();
+    damaged();
+    wrapped();
+
+    return failures ? 1 : 0;
+}
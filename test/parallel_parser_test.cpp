@@ -0,0 +1,124 @@
+#include "../parallel_parser.h"
+#include "../parser.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what, unsigned round)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "round %u: %s\n", round, what);
+            ++failures;
+        }
+    }
+
+    // documents before a malformed one all arrive before parse() throws, however
+    // the chunks happen to be scheduled
+    void malformed_last_document(bool ordered, unsigned round)
+    {
+        std::string input;
+
+        for(int i= 0; i < 50; ++i)
+        {
+            input+= "---\nid: " + std::to_string(i) + "\nlist: [a, b, c]\n";
+        }
+        input+= "---\nbroken: [\n";
+
+        yamlman::parallel_options options;
+
+        options.threads= 4;
+        options.chunk_size= 1;
+        options.ordered= ordered;
+
+        yamlman::parallel_parser parser(input.data(), input.size(), options);
+        std::vector<bool> seen(51);
+        std::size_t ends= 0;
+        bool thrown= false;
+
+        parser.on_event([&](std::size_t document, yamlman::event const& e){
+            if(e.type() == yamlman::event_type::document_end)
+            {
+                seen[document]= true;
+                ++ends;
+            }
+        });
+        try
+        {
+            parser.parse();
+        }
+        catch(yamlman::parse_error const&)
+        {
+            thrown= true;
+        }
+
+        check(thrown, "no parse_error", round);
+        check(ends == 50, "documents missing or repeated", round);
+        for(std::size_t i= 0; i < 50; ++i)
+        {
+            check(seen[i], "a document before the error is missing", round);
+        }
+        check(!seen[50], "the malformed document was delivered", round);
+    }
+
+    // marks relocated into the whole input are the serial parser's, past a byte
+    // order mark and with line breaks other than \n
+    void marks_match_serial()
+    {
+        std::string input= "\xEF\xBB\xBF";
+
+        for(int i= 0; i < 20; ++i)
+        {
+            input+= i % 2 ? "---\r\nk: v\r\n" : "---\rk: [\xC3\xA9, x]\r";
+        }
+
+        std::vector<yamlman::mark> serial, parallel;
+        yamlman::parser parser(input);
+
+        while(yamlman::event const* e= parser.next())
+        {
+            if(e->type() != yamlman::event_type::stream_start && e->type() != yamlman::event_type::stream_end)
+            {
+                serial.push_back(e->base()->start_mark());
+            }
+        }
+
+        yamlman::parallel_options options;
+
+        options.threads= 3;
+        options.chunk_size= 1;
+
+        yamlman::parallel_parser pp(input.data(), input.size(), options);
+
+        pp.on_event([&](std::size_t, yamlman::event const& e){
+            parallel.push_back(e.base()->start_mark());
+        });
+        pp.parse();
+
+        check(serial.size() == parallel.size(), "event counts differ from the serial parser", 0);
+        for(std::size_t i= 0; i < serial.size() && i < parallel.size(); ++i)
+        {
+            if(serial[i].index() != parallel[i].index() || serial[i].line() != parallel[i].line() || serial[i].column() != parallel[i].column())
+            {
+                check(false, "a mark differs from the serial parser", 0);
+                break;
+            }
+        }
+    }
+} // namespace
+
+int main()
+{
+    marks_match_serial();
+    for(unsigned round= 0; round < 200; ++round)
+    {
+        malformed_last_document(true, round);
+        malformed_last_document(false, round);
+    }
+
+    return failures ? 1 : 0;
+}
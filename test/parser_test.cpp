@@ -0,0 +1,144 @@
+#include "../parser.h"
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            ++failures;
+        }
+    }
+
+    std::size_t events(yamlman::parser& parser)
+    {
+        std::size_t n= 0;
+
+        parser.on_event([&n](yamlman::event const&){ ++n; });
+        check(parser.parse(), "an empty input failed to parse");
+
+        return n;
+    }
+
+    // an empty input is a stream start and end, whatever its buffer; libyaml
+    // itself asserts on a NULL one
+    void empty_inputs()
+    {
+        {
+            yamlman::parser parser{std::string_view()};
+
+            check(events(parser) == 2, "an empty string_view isn't an empty stream");
+        }
+        {
+            yamlman::parser parser(nullptr, 0);
+
+            check(events(parser) == 2, "parser(nullptr, 0) isn't an empty stream");
+        }
+        {
+            yamlman::parser parser("a: b");
+
+            parser.reset(nullptr, 0);
+            check(events(parser) == 2, "reset(nullptr, 0) isn't an empty stream");
+        }
+        {
+            yamlman::parser parser("a: b");
+
+            parser.reset(std::string_view());
+            check(events(parser) == 2, "reset(std::string_view()) isn't an empty stream");
+        }
+        {
+            yamlman::parser parser{std::string_view()};
+
+            check(parser.next() && parser.next() && !parser.next() && !parser.error(), "next() on an empty string_view");
+        }
+    }
+
+    std::string describe(yamlman::event const& e)
+    {
+        std::string s= std::to_string(static_cast<int>(e.type()));
+
+        if(e.type() == yamlman::event_type::scalar)
+        {
+            s+= ' ';
+            s+= e.get<yamlman::scalar_event>().value();
+        }
+        return s;
+    }
+
+    std::vector<std::string> collect(std::string const& input, yamlman::pipeline_options const* options)
+    {
+        yamlman::parser parser(input);
+        std::vector<std::string> events;
+
+        parser.on_event([&events](yamlman::event const& e){ events.push_back(describe(e)); });
+        if(options)
+        {
+            parser.parse(*options);
+        }
+        else
+        {
+            parser.parse();
+        }
+        return events;
+    }
+
+    // the producer and the consumer block on each other through a ring of one
+    // batch of one event, and through the defaults
+    void pipeline()
+    {
+        std::string input;
+
+        for(unsigned i= 0; i < 5000; ++i)
+        {
+            input+= "- k" + std::to_string(i) + ": [a, b, {c: d}]\n";
+        }
+
+        std::vector<std::string> const expected= collect(input, nullptr);
+        yamlman::pipeline_options const defaults;
+        yamlman::pipeline_options tiny;
+
+        tiny.batch_size= 1;
+        tiny.batches= 1;
+        check(collect(input, &tiny) == expected, "a pipeline of single events differs from parse()");
+        check(collect(input, &defaults) == expected, "the default pipeline differs from parse()");
+
+        // a throwing handler stops the producer, which may be asleep on a full ring
+        yamlman::parser parser(input);
+        std::size_t n= 0;
+
+        parser.on_event([&n](yamlman::event const&){
+            if(++n == 1000)
+            {
+                throw std::runtime_error("stop");
+            }
+        });
+
+        bool thrown= false;
+
+        try
+        {
+            parser.parse(tiny);
+        }
+        catch(std::runtime_error const&)
+        {
+            thrown= true;
+        }
+        check(thrown && n == 1000, "a handler's exception didn't end the pipeline");
+    }
+} // namespace
+
+int main()
+{
+    empty_inputs();
+    pipeline();
+
+    return failures ? 1 : 0;
+}
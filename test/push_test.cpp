@@ -0,0 +1,212 @@
+#include "../parser.h"
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            ++failures;
+        }
+    }
+
+    std::string describe(yamlman::event const& e)
+    {
+        yamlman::mark const start= e.base()->start_mark();
+        yamlman::mark const end= e.base()->end_mark();
+        std::string s= std::to_string(static_cast<int>(e.type()));
+
+        s+= " " + std::to_string(start.index()) + ":" + std::to_string(start.line()) + ":" + std::to_string(start.column());
+        s+= " " + std::to_string(end.index()) + ":" + std::to_string(end.line()) + ":" + std::to_string(end.column());
+        if(e.type() == yamlman::event_type::scalar)
+        {
+            s+= ' ';
+            s+= e.get<yamlman::scalar_event>().value();
+        }
+        return s;
+    }
+
+    void record(yamlman::parser& parser, std::vector<std::string>& events)
+    {
+        parser.on_event([&events](yamlman::event const& e){ events.push_back(describe(e)); });
+        parser.on_error([&events](yamlman::parse_error const& e){ events.push_back(std::string("error ") + e.what()); });
+    }
+
+    std::vector<std::string> parsed(std::string const& input)
+    {
+        yamlman::parser parser(input);
+        std::vector<std::string> events;
+
+        record(parser, events);
+        parser.parse();
+
+        return events;
+    }
+
+    std::vector<std::string> pushed(std::string const& input, std::size_t chunk)
+    {
+        yamlman::parser parser;
+        std::vector<std::string> events;
+
+        record(parser, events);
+        for(std::size_t i= 0; i < input.size(); i+= chunk)
+        {
+            parser.feed(std::string_view(input).substr(i, chunk));
+        }
+        parser.finish();
+
+        return events;
+    }
+
+    char const* const inputs[]= {
+        "",
+        "a: b\n",
+        "%YAML 1.1\n---\n- &x [1, 2, {k: v}]\n- *x\n- !!str 3\n...\n--- second\n",
+        "text: |\n  line one\n  line two\n\nfolded: >-\n  a\n  b\n'quoted': \"esc\\taped \\u00e9\"\n",
+        "\xef\xbb\xbf" "bom: \xc3\xa9" "t\xc3\xa9\r\nnext: line\r\n",
+        "a: [1, 2\nb: c\n",
+    };
+
+    // the events, their marks and the errors don't depend on how the input is cut
+    void byte_at_a_time()
+    {
+        for(char const* input : inputs)
+        {
+            std::vector<std::string> const expected= parsed(input);
+
+            check(pushed(input, 1) == expected, "a byte at a time differs from parse()");
+            check(pushed(input, 3) == expected, "three bytes at a time differ from parse()");
+            check(pushed(input, 4096) == expected, "one feed differs from parse()");
+        }
+    }
+
+    // an exception leaves the fiber and comes out of the feed() that ran the handler
+    void throwing_handler()
+    {
+        yamlman::parser parser;
+        std::size_t n= 0;
+
+        parser.on_scalar([&n](yamlman::scalar_event const& e){
+            ++n;
+            if(e.value() == "boom")
+            {
+                throw std::runtime_error("boom");
+            }
+        });
+
+        bool thrown= false;
+
+        check(parser.feed("a: b\n"), "a good chunk failed");
+        try
+        {
+            parser.feed("c: boom\nd: e\n");
+        }
+        catch(std::runtime_error const&)
+        {
+            thrown= true;
+        }
+        check(thrown, "a handler's exception didn't come out of feed()");
+        check(n == 4, "scalars after the throw were delivered");
+
+        // the parser is usable again after a reset
+        n= 0;
+        parser.reset();
+        check(parser.feed("x: y\n") && parser.finish() && n == 2, "a reset after a throw doesn't parse");
+        n= 0;
+        parser.reset("p: q\n");
+        check(parser.parse() && n == 2, "a reset to a string after a throw doesn't parse");
+    }
+
+    // a parse left halfway is abandoned without its handlers
+    void abandoned()
+    {
+        {
+            yamlman::parser parser;
+            std::size_t n= 0;
+
+            parser.on_event([&n](yamlman::event const&){ ++n; });
+            parser.feed("a: [1, 2, {b: ");
+            n= 0;
+            // the destructor settles the fiber; nothing is delivered
+        }
+        {
+            yamlman::parser parser;
+            std::vector<std::string> events;
+
+            record(parser, events);
+            parser.feed("a: [1, 2, {b: ");
+            events.clear();
+            parser.reset("x: y\n");
+            parser.parse();
+            check(events == parsed("x: y\n"), "reset() mid-feed leaks the abandoned parse");
+
+            events.clear();
+            parser.reset();
+            parser.feed("k: [v");
+            events.clear();
+            parser.reset();
+            parser.feed("x: ");
+            parser.feed("y\n");
+            parser.finish();
+            check(events == parsed("x: y\n"), "reset() to pushed input mid-feed leaks the abandoned parse");
+        }
+        {
+            yamlman::parser parser;
+            std::vector<std::string> events;
+
+            record(parser, events);
+            parser.feed("x: ");
+            parser.feed("y\n");
+            // parse() takes the pushed input as finished
+            parser.parse();
+            check(events == parsed("x: y\n"), "parse() after feed() doesn't finish the stream");
+        }
+    }
+
+    void misuse()
+    {
+        bool thrown= false;
+        yamlman::parser parser("a: b");
+
+        try
+        {
+            parser.feed("c: d");
+        }
+        catch(std::logic_error const&)
+        {
+            thrown= true;
+        }
+        check(thrown, "feed() on in-memory input didn't throw");
+
+        thrown= false;
+        parser.reset();
+        parser.finish();
+        try
+        {
+            parser.feed("c: d");
+        }
+        catch(std::logic_error const&)
+        {
+            thrown= true;
+        }
+        check(thrown, "feed() after finish() didn't throw");
+    }
+} // namespace
+
+int main()
+{
+    byte_at_a_time();
+    throwing_handler();
+    abandoned();
+    misuse();
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+#include "../resolve.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string_view>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what, std::string_view value)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "%s: '%.*s'\n", what, static_cast<int>(value.size()), value.data());
+            ++failures;
+        }
+    }
+
+    yamlman::scalar_value plain(std::string_view value, std::string_view tag= std::string_view())
+    {
+        return yamlman::resolve(value, tag, true);
+    }
+
+    void null(std::string_view value)
+    {
+        check(std::holds_alternative<std::nullptr_t>(plain(value)), "not null", value);
+    }
+
+    void integer(std::string_view value, std::int64_t expected)
+    {
+        yamlman::scalar_value const v= plain(value);
+
+        check(std::holds_alternative<std::int64_t>(v) && std::get<std::int64_t>(v) == expected, "not the integer", value);
+    }
+
+    void floating(std::string_view value, double expected)
+    {
+        yamlman::scalar_value const v= plain(value);
+
+        check(std::holds_alternative<double>(v) && std::get<double>(v) == expected, "not the float", value);
+    }
+
+    void big(std::string_view value)
+    {
+        yamlman::scalar_value const v= plain(value);
+
+        check(std::holds_alternative<yamlman::big_integer>(v) && std::get<yamlman::big_integer>(v).text == value, "not a big integer", value);
+    }
+
+    void string(std::string_view value, std::string_view tag= std::string_view())
+    {
+        check(std::holds_alternative<std::string_view>(plain(value, tag)), "not a string", value);
+    }
+
+    void core_schema()
+    {
+        null("~");
+        null("null");
+        null("Null");
+        null("NULL");
+        null("");
+        string("nULL");
+
+        check(std::get<bool>(plain("True")) && !std::get<bool>(plain("FALSE")), "not the bool", "True/FALSE");
+        string("yes");
+
+        integer("0", 0);
+        integer("-17", -17);
+        integer("+17", 17);
+        integer("0x1F", 31);
+        integer("0xff", 255);
+        integer("0o17", 15);
+        string("0x");
+        string("0xg");
+        string("0o8");
+        integer("9223372036854775807", std::numeric_limits<std::int64_t>::max());
+        integer("-9223372036854775808", std::numeric_limits<std::int64_t>::min());
+
+        floating("1.5", 1.5);
+        floating("-.5", -0.5);
+        floating("1e3", 1000.0);
+        floating(".inf", std::numeric_limits<double>::infinity());
+        floating("-.Inf", -std::numeric_limits<double>::infinity());
+        floating("+.INF", std::numeric_limits<double>::infinity());
+        check(std::isnan(std::get<double>(plain(".NaN"))), "not nan", ".NaN");
+        string(".infinity");
+        string("1.5.2");
+    }
+
+    // decimals past int64_t keep their digits instead of rounding
+    void big_integers()
+    {
+        big("9223372036854775808");
+        big("-9223372036854775809");
+        big("+123456789012345678901234567890");
+        big("18446744073709551616");
+
+        yamlman::scalar_value const v= plain("123456789012345678901234567890", "tag:yaml.org,2002:float");
+
+        check(std::holds_alternative<double>(v) && std::get<double>(v) > 1.2e29, "a tagged float stayed a big integer", "123456789012345678901234567890");
+    }
+
+    void tags_and_styles()
+    {
+        string("42", "tag:yaml.org,2002:str");
+        string("~", "tag:yaml.org,2002:str");
+        string("42", "!custom");
+        check(std::holds_alternative<std::string_view>(yamlman::resolve("42", std::string_view(), false)), "a quoted scalar was resolved", "42");
+        check(std::holds_alternative<std::int64_t>(yamlman::resolve("0x10", "tag:yaml.org,2002:int", false)), "a tagged int stayed a string", "0x10");
+        check(std::holds_alternative<std::string_view>(plain("abc", "tag:yaml.org,2002:int")), "a bad int isn't left a string", "abc");
+    }
+} // namespace
+
+int main()
+{
+    core_schema();
+    big_integers();
+    tags_and_styles();
+
+    return failures ? 1 : 0;
+}
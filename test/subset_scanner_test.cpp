@@ -0,0 +1,256 @@
+#include "../subset_scanner.h"
+#include "../parser.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// the fast path against libyaml: whenever the scanner takes an input, its
+// events must be libyaml's, values, flags and marks included
+namespace
+{
+    int failures= 0;
+
+    std::string describe(yamlman::event const& e)
+    {
+        using namespace yamlman;
+
+        std::string res= std::to_string(static_cast<int>(e.type()));
+
+        if(base_event const* const base= e.base())
+        {
+            for(mark const m : {base->start_mark(), base->end_mark()})
+            {
+                res+= " " + std::to_string(m.line()) + ":" + std::to_string(m.column()) + ":" + std::to_string(m.index());
+            }
+        }
+        switch(e.type())
+        {
+            case event_type::document_start:
+                res+= e.get<document_start_event>().implicit() ? " implicit" : "";
+                break;
+            case event_type::document_end:
+                res+= e.get<document_end_event>().implicit() ? " implicit" : "";
+                break;
+            case event_type::scalar:{
+                scalar_event const& ev= e.get<scalar_event>();
+
+                res+= " " + std::string(stringify(ev.style())) + (ev.plain_implicit() ? " p" : "") + (ev.quoted_implicit() ? " q" : "");
+                res+= " [" + std::string(ev.value()) + "]";
+                break;
+            }
+            case event_type::sequence_start:
+                res+= " " + std::string(stringify(e.get<sequence_start_event>().style()));
+                break;
+            case event_type::mapping_start:
+                res+= " " + std::string(stringify(e.get<mapping_start_event>().style()));
+                break;
+            default:
+                break;
+        }
+
+        return res;
+    }
+
+    // compares the scanner with libyaml; inside says whether the input is known
+    // to lie in the subset, so that the scanner must not give up on it
+    void compare(std::string const& input, bool inside, char const* what)
+    {
+        std::vector<yamlman::event> fast;
+        std::vector<std::string> expected, got;
+
+        if(!yamlman::scan_subset(input.data(), input.size(), fast))
+        {
+            if(inside)
+            {
+                std::fprintf(stderr, "%s: the scanner gave up\n", what);
+                ++failures;
+            }
+            return;
+        }
+        for(yamlman::event const& e : fast)
+        {
+            got.push_back(describe(e));
+        }
+
+        yamlman::parser parser(input);
+
+        while(yamlman::event const* e= parser.next())
+        {
+            expected.push_back(describe(*e));
+        }
+        if(parser.error())
+        {
+            std::fprintf(stderr, "%s: the scanner took input libyaml rejects\n", what);
+            ++failures;
+            return;
+        }
+        for(std::size_t i= 0; i < expected.size() || i < got.size(); ++i)
+        {
+            std::string const none= "(none)";
+            std::string const& lhs= i < expected.size() ? expected[i] : none;
+            std::string const& rhs= i < got.size() ? got[i] : none;
+
+            if(lhs != rhs)
+            {
+                std::fprintf(stderr, "%s: event %zu is %.200s, libyaml has %.200s\n", what, i, rhs.c_str(), lhs.c_str());
+                ++failures;
+                return;
+            }
+        }
+    }
+
+    // lines over the scanner's 64 KiB window, plain and quoted
+    void long_lines()
+    {
+        for(std::size_t length : {std::size_t(65535), std::size_t(65536), std::size_t(70000), std::size_t(200000)})
+        {
+            std::string const text(length, 'x');
+
+            compare("key: " + text + "\nnext: 1\n", true, "long plain value");
+            compare("key: '" + text + "'\nnext: 1\n", true, "long single-quoted value");
+            compare("key: \"" + text + "\"\nnext: 1\n", true, "long double-quoted value");
+            // libyaml takes no simple key past 1024 characters, nor should the scanner
+            compare(text + ": v\n", false, "long key");
+            compare("- " + text + "\n- " + text + "\n", true, "long sequence items");
+        }
+    }
+
+    // quotes opening or closing on either side of the 64-byte blocks the bitmaps
+    // are built from, and of the 64 KiB window
+    void quotes_across_boundaries()
+    {
+        for(std::size_t boundary : {std::size_t(64), std::size_t(128), std::size_t(65536)})
+        {
+            for(std::size_t shift= 0; shift < 8; ++shift)
+            {
+                for(char const quote : {'\'', '"'})
+                {
+                    std::string input;
+
+                    while(input.size() + 12 < boundary - shift)
+                    {
+                        input+= "k: v\n";
+                    }
+                    input+= std::string(boundary - shift - input.size() - 4, 'p') + ": ";
+                    input+= std::string(1, quote) + "a # b: c" + std::string(1, quote) + "\nz: " + quote + quote + "\n";
+                    compare(input, true, "quote across a block boundary");
+                }
+            }
+        }
+    }
+
+    // blanks after scalars, markers and keys, and lines of blanks only
+    void trailing_spaces()
+    {
+        compare("a: b   \nc: 'd'  \ne: \"f\" \n", true, "spaces after values");
+        compare("a:   \n  b: c  \n", true, "spaces after a key");
+        compare("--- \na: b\n... \n", true, "spaces after markers");
+        compare("- a  \n-   \n- 'b' # c  \n", true, "spaces in a sequence");
+        compare("a: b\n   \n\nc: d\n  ", true, "blank lines");
+        compare("a: b c  d   \n", true, "inner spaces");
+    }
+
+    // in the subset: no escapes, not even a doubled single quote
+    char const* const scalars[]= {"v", "a b", "a#b", "x:y", "'q'", "'a: b'", "\"d q\"", "''", "\"\"", "1.5", "~", "'# no'"};
+    char const* const tails[]= {"", " ", "   ", "  # note", " #"};
+
+    // a well-formed block node at this indent, nested up to depth levels
+    void node(std::mt19937& rng, std::string& out, std::size_t indent, int depth)
+    {
+        bool const mapping= rng() % 2;
+        int const items= 1 + rng() % 3;
+
+        for(int i= 0; i < items; ++i)
+        {
+            if(rng() % 8 == 0)
+            {
+                out+= std::string(indent, ' ') + "# comment\n";
+            }
+            out+= std::string(indent, ' ') + (mapping ? "k" + std::to_string(i) + ":" : "-");
+            if(depth > 0 && rng() % 3 == 0)
+            {
+                out+= std::string(tails[rng() % 5]) + "\n";
+                node(rng, out, indent + 2, depth - 1);
+            }
+            else
+            {
+                out+= std::string(" ") + scalars[rng() % 12] + tails[rng() % 5] + "\n";
+            }
+        }
+    }
+
+    // well-formed streams of one or more documents, which the scanner must take
+    void random_documents()
+    {
+        std::mt19937 rng(15);
+
+        for(int round= 0; round < 20000; ++round)
+        {
+            std::string input;
+            int const documents= 1 + rng() % 3;
+
+            for(int d= 0; d < documents; ++d)
+            {
+                if(d > 0 || rng() % 2)
+                {
+                    input+= rng() % 4 ? "---\n" : "--- # doc\n";
+                }
+                node(rng, input, 0, 3);
+                if(rng() % 4 == 0)
+                {
+                    input+= "...\n";
+                }
+            }
+            compare(input, true, "random document");
+        }
+    }
+
+    // random lines, mostly malformed or outside the subset; whatever the
+    // scanner takes must still be what libyaml makes of it
+    void random_lines()
+    {
+        std::mt19937 rng(16);
+        char const* const noise[]= {"", " ", "\t", "\r", "  # note", ": x", " &a", " !t", " [1]", " 'open", " 'it''s'"};
+
+        for(int round= 0; round < 20000; ++round)
+        {
+            std::string input;
+            int const lines= rng() % 12;
+
+            for(int i= 0; i < lines; ++i)
+            {
+                input+= std::string(rng() % 5, ' ');
+                switch(rng() % 4)
+                {
+                    case 0:
+                        input+= "- ";
+                        break;
+                    case 1:
+                        input+= "k" + std::to_string(rng() % 4) + ": ";
+                        break;
+                    case 2:
+                        input+= "k" + std::to_string(rng() % 4) + ":";
+                        break;
+                    default:
+                        break;
+                }
+                input+= scalars[rng() % 12];
+                input+= noise[rng() % 11];
+                input+= rng() % 16 ? "\n" : "\n---\n";
+            }
+            compare(input, false, "random lines");
+        }
+    }
+} // namespace
+
+int main()
+{
+    long_lines();
+    quotes_across_boundaries();
+    trailing_spaces();
+    random_documents();
+    random_lines();
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#include "../symbol_table.h"
+#include "../event_tape.h"
+#include "../parser.h"
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    int failures= 0;
+
+    void check(bool ok, char const* what)
+    {
+        if(!ok)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            ++failures;
+        }
+    }
+
+    // the anchor and tag ids and views of every scalar and collection start
+    struct seen
+    {
+        std::vector<std::pair<yamlman::symbol, yamlman::symbol>> ids;
+        std::vector<std::pair<std::string_view, std::string_view>> names;
+    };
+
+    template<class Event>
+    void note(seen& s, Event const& e)
+    {
+        s.ids.emplace_back(e.anchor_id(), e.tag_id());
+        s.names.emplace_back(e.anchor(), e.tag());
+    }
+
+    void watch(yamlman::parser& parser, seen& s)
+    {
+        parser
+            .on_scalar([&s](yamlman::scalar_event const& e){ note(s, e); })
+            .on_sequence_start([&s](yamlman::sequence_start_event const& e){ note(s, e); })
+            .on_mapping_start([&s](yamlman::mapping_start_event const& e){ note(s, e); })
+        ;
+    }
+
+    // the same anchors and tags in every document, in a different order in the second
+    std::string const input=
+        "--- !doc\n"
+        "a: &x !t 1\n"
+        "b: !u [&y 2, !t 3]\n"
+        "--- !doc\n"
+        "b: !u [&y 2, !t 3]\n"
+        "a: &x !t 1\n"
+    ;
+
+    // an id is given on first sight and kept by every later document
+    void across_documents()
+    {
+        yamlman::symbol_table symbols;
+        seen s;
+        yamlman::parser parser(input);
+
+        watch(parser, s);
+        parser.symbols(&symbols).parse();
+
+        // !doc, then a: x t 1, b: u [y 2, t 3]
+        std::vector<std::pair<yamlman::symbol, yamlman::symbol>> const first= {
+            {0, 1}, {0, 0}, {2, 3}, {0, 0}, {0, 4}, {5, 0}, {0, 3},
+        };
+        std::vector<std::pair<yamlman::symbol, yamlman::symbol>> const second= {
+            {0, 1}, {0, 0}, {0, 4}, {5, 0}, {0, 3}, {0, 0}, {2, 3},
+        };
+
+        check(s.ids.size() == first.size() + second.size(), "the wrong number of events");
+        check(std::vector<std::pair<yamlman::symbol, yamlman::symbol>>(s.ids.begin(), s.ids.begin() + first.size()) == first, "the first document's ids");
+        check(std::vector<std::pair<yamlman::symbol, yamlman::symbol>>(s.ids.begin() + first.size(), s.ids.end()) == second, "the second document's ids");
+        check(symbols.size() == 6, "a repeated anchor or tag got a new id");
+        check(symbols.name(0).empty() && symbols.name(2) == "x" && symbols.name(3) == "!t", "names don't match their ids");
+
+        for(std::size_t i= 0; i < s.ids.size(); ++i)
+        {
+            check(symbols.name(s.ids[i].first) == s.names[i].first && symbols.name(s.ids[i].second) == s.names[i].second, "an event's views aren't its ids' names");
+        }
+    }
+
+    // the table outlives inputs and parsers; ids carry over, and views stay valid
+    void across_inputs()
+    {
+        yamlman::symbol_table symbols;
+        seen before, after;
+
+        {
+            std::string text= "a: &x !t 1\n";
+            yamlman::parser parser(text);
+
+            watch(parser, before);
+            parser.symbols(&symbols).parse();
+            text.assign(text.size(), '#');
+        }
+        check(before.names[2].first == "x" && before.names[2].second == "!t", "views died with their input");
+
+        yamlman::parser parser("- !t &z 1\n- !t &x 2\n");
+
+        watch(parser, after);
+        parser.symbols(&symbols).parse();
+        check(after.ids[1] == std::make_pair(yamlman::symbol(3), yamlman::symbol(2)), "a new anchor wasn't added after the others");
+        check(after.ids[2] == before.ids[2], "ids changed from one input to the next");
+
+        // one table, the same ids whichever way the events arrive
+        seen pipelined, replayed;
+        yamlman::parser other(input);
+        yamlman::symbol_table fresh;
+
+        watch(other, pipelined);
+        other.symbols(&fresh).parse(yamlman::pipeline_options());
+
+        yamlman::tape_writer writer;
+        std::ostringstream tape;
+
+        yamlman::parser(input).on_event([&writer](yamlman::event const& e){ writer.add(e); }).parse();
+        writer.write(tape, 0);
+
+        std::string const recorded= tape.str();
+        yamlman::tape_reader reader(recorded.data(), recorded.size());
+        yamlman::parser replay(reader);
+
+        watch(replay, replayed);
+        replay.symbols(&fresh).parse();
+        check(pipelined.ids == replayed.ids, "the pipeline and a tape replay disagree on ids");
+        check(fresh.size() == 6, "a replay added symbols the pipeline had");
+    }
+
+    void clear()
+    {
+        yamlman::symbol_table symbols;
+
+        check(symbols.intern("") == 0 && symbols.intern("a") == 1 && symbols.intern("b") == 2 && symbols.intern("a") == 1, "intern() ids");
+        symbols.clear();
+        check(symbols.size() == 1 && symbols.intern("b") == 1, "clear() doesn't start the ids over");
+    }
+} // namespace
+
+int main()
+{
+    across_documents();
+    across_inputs();
+    clear();
+
+    return failures ? 1 : 0;
+}
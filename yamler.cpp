@@ -1,6 +1,22 @@
 #include "parser.h"
 #include "event.h"
+#include "emitter.h"
+#include "mapped_file.h"
+#include "resolve.h"
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+#include <unistd.h>
 
 std::ostream& operator << (std::ostream& ostream, yamlman::mark const& mark)
 {
@@ -11,95 +27,564 @@ std::ostream& operator << (std::ostream& ostream, yamlman::mark const& mark)
     return ostream;
 }
 
+namespace
+{
+    // collects output and writes it to a descriptor in large chunks. only what
+    // was commit()ed is ever written, so that an exception drops a partial
+    // document rather than leaving it unterminated. flush() throws
+    // std::system_error when the descriptor takes no more, so call it at the
+    // end; the destructor only writes what an exception left behind.
+    class output
+    {
+        public:
+            explicit output(int fd) : _fd(fd), _committed(0)
+            {
+                _buffer.reserve(capacity);
+            }
+            ~output()
+            {
+                try
+                {
+                    flush();
+                }
+                catch(std::system_error const&)
+                {
+                }
+            }
+        public:
+            void put(char c)
+            {
+                _buffer.push_back(c);
+            }
+
+            void write(std::string_view s)
+            {
+                _buffer.append(s.data(), s.size());
+            }
+
+            // everything put so far is complete
+            void commit()
+            {
+                _committed= _buffer.size();
+                if(_committed >= capacity)
+                {
+                    flush();
+                }
+            }
+
+            void flush()
+            {
+                for(std::size_t done= 0; done < _committed; )
+                {
+                    ssize_t const n= ::write(_fd, _buffer.data() + done, _committed - done);
+
+                    if(n < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if(n <= 0)
+                    {
+                        _buffer.clear();
+                        _committed= 0;
+                        throw std::system_error(n < 0 ? errno : EIO, std::generic_category(), "write");
+                    }
+                    done+= n;
+                }
+                _buffer.erase(0, _committed);
+                _committed= 0;
+            }
+        private:
+            static std::size_t const capacity= 1024 * 1024;
+
+            int _fd;
+            std::string _buffer;
+            std::size_t _committed;
+    };
+
+    // writes each document as one line of json, straight from the events;
+    // only the nesting is kept, so memory doesn't grow with the input.
+    // scalars go through the core schema; keys are always strings.
+    class json_writer
+    {
+        public:
+            explicit json_writer(output& out) : _out(out)
+            {
+            }
+        public:
+            void on_document_end()
+            {
+                _out.put('\n');
+                _out.commit();
+            }
+
+            void on_scalar(yamlman::scalar_event const& e)
+            {
+                if(begin_item())
+                {
+                    string(e.value());
+                    return;
+                }
+
+                std::visit([&](auto const& v){
+                    literal(v, e.value());
+                }, yamlman::resolve(e));
+            }
+
+            void on_start(char open)
+            {
+                if(begin_item())
+                {
+                    throw std::runtime_error("json keys have to be scalars");
+                }
+                _out.put(open);
+                _frames.push_back(frame{open == '{', 0});
+            }
+
+            void on_end(char close)
+            {
+                _frames.pop_back();
+                _out.put(close);
+            }
+        private:
+            struct frame
+            {
+                bool mapping;
+                std::size_t items;
+            };
+
+            // writes the separator ahead of the next node; returns whether the
+            // node is a mapping key
+            bool begin_item()
+            {
+                if(_frames.empty())
+                {
+                    return false;
+                }
+
+                frame& top= _frames.back();
+                bool const key= top.mapping && top.items % 2 == 0;
+
+                if(top.mapping && !key)
+                {
+                    _out.put(':');
+                }
+                else if(top.items)
+                {
+                    _out.put(',');
+                }
+                ++top.items;
+
+                return key;
+            }
+
+            void literal(std::nullptr_t, std::string_view)
+            {
+                _out.write("null");
+            }
+
+            void literal(bool v, std::string_view)
+            {
+                _out.write(v ? "true" : "false");
+            }
+
+            // hex and octal come out in decimal
+            void literal(std::int64_t v, std::string_view)
+            {
+                char buffer[24];
+                auto const r= std::to_chars(buffer, buffer + sizeof(buffer), v);
+
+                _out.write(std::string_view(buffer, r.ptr - buffer));
+            }
+
+            // json has no infinities or nans; they stay as written, in a string
+            void literal(double v, std::string_view text)
+            {
+                if(!std::isfinite(v))
+                {
+                    string(text);
+                    return;
+                }
+
+                char buffer[32];
+#if defined(__cpp_lib_to_chars)
+                auto const r= std::to_chars(buffer, buffer + sizeof(buffer), v);
+                std::size_t const n= r.ptr - buffer;
+#else
+                std::size_t const n= std::snprintf(buffer, sizeof(buffer), "%.17g", v);
+#endif
+
+                _out.write(std::string_view(buffer, n));
+            }
+
+            void literal(std::string_view v, std::string_view)
+            {
+                string(v);
+            }
+
+            // past int64_t; json numbers have no limit, so the digits go out as
+            // written, less a '+' and leading zeros json doesn't allow
+            void literal(yamlman::big_integer v, std::string_view)
+            {
+                std::string_view digits= v.text;
+
+                if(digits[0] == '-')
+                {
+                    _out.put('-');
+                }
+                if(digits[0] == '-' || digits[0] == '+')
+                {
+                    digits.remove_prefix(1);
+                }
+                _out.write(digits.substr(std::min(digits.find_first_not_of('0'), digits.size() - 1)));
+            }
+
+            void string(std::string_view v)
+            {
+                static char const hex[]= "0123456789abcdef";
+                std::size_t from= 0;
+
+                _out.put('"');
+                for(std::size_t i= 0; i < v.size(); ++i)
+                {
+                    unsigned char const c= v[i];
+
+                    if(c >= 0x20 && c != '"' && c != '\\')
+                    {
+                        continue;
+                    }
+
+                    _out.write(v.substr(from, i - from));
+                    from= i + 1;
+                    _out.put('\\');
+                    switch(c)
+                    {
+                        case '"':
+                        case '\\':
+                            _out.put(c);
+                            break;
+                        case '\n':
+                            _out.put('n');
+                            break;
+                        case '\t':
+                            _out.put('t');
+                            break;
+                        case '\r':
+                            _out.put('r');
+                            break;
+                        default:
+                            _out.write("u00");
+                            _out.put(hex[c >> 4]);
+                            _out.put(hex[c & 0xf]);
+                            break;
+                    }
+                }
+                _out.write(v.substr(from));
+                _out.put('"');
+            }
+        private:
+            output& _out;
+            std::vector<frame> _frames;
+    };
+
+    void print_events(yamlman::parser& parser)
+    {
+        using namespace yamlman;
+
+        parser
+            .on_stream_start([](stream_start_event const& e){
+                std::cout
+                    << "[stream start]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << "[encoding: " << stringify(e.encoding()) << "]"
+                    << '\n';
+            })
+            .on_document_start([](document_start_event const& e){
+                std::cout << "[document start]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << "[version: " << e.version_major() << "." << e.version_minor() << "]"
+                    << '\n';
+            })
+            .on_alias([](alias_event const& e){
+                std::cout << "[alias]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << "[anchor: " <<  e.anchor() << "]"
+                    << '\n';
+            })
+            .on_scalar([](scalar_event const& e){
+                std::cout << "[scalar]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << "[anchor: " << e.anchor() << "]"
+                    << "[tag: " << e.tag() << "]"
+                    << "[value: " << e.value() << "]"
+                    << "[plain_implicit: " << e.plain_implicit() << "]"
+                    << "[quoted_implicit: " << e.quoted_implicit() << "]"
+                    << "[style: " << stringify(e.style()) << "]"
+                    << '\n';
+            })
+            .on_mapping_start([](mapping_start_event const& e){
+                std::cout << "[mapping start]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << "[anchor: " << e.anchor() << "]"
+                    << "[tag: " << e.tag() << "]"
+                    << "[implicit: " << e.implicit() << "]"
+                    << "[style: " << stringify(e.style()) << "]"
+                    << '\n';
+            })
+            .on_mapping_end([](mapping_end_event const& e){
+                std::cout << "[mapping end]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << '\n';
+            })
+            .on_sequence_start([](sequence_start_event const& e){
+                std::cout << "[sequence start]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << "[anchor: " << e.anchor() << "]"
+                    << "[tag: " << e.tag() << "]"
+                    << "[implicit: " << e.implicit() << "]"
+                    << "[style: " << stringify(e.style()) << "]"
+                    << '\n';
+            })
+            .on_sequence_end([](sequence_end_event const& e){
+                std::cout << "[sequence end]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << '\n';
+            })
+            .on_document_end([](document_end_event const& e){
+                std::cout << "[document end]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << "[implicit: " << e.implicit() << "]"
+                    << '\n';
+            })
+            .on_stream_end([](stream_end_event const& e){
+                std::cout << "[stream end]"
+                    << "[start: " << e.start_mark() << "]"
+                    << "[end: " << e.end_mark() << "]"
+                    << '\n';
+            })
+            .parse()
+        ;
+        if(!std::cout.flush())
+        {
+            throw std::runtime_error("write: the output failed");
+        }
+    }
+
+    // one line per document; a document that fails is left out, not cut short
+    void to_json(yamlman::parser& parser)
+    {
+        using namespace yamlman;
+
+        output out(STDOUT_FILENO);
+        json_writer writer(out);
+
+        parser
+            .on_document_end([&](document_end_event const&){
+                writer.on_document_end();
+            })
+            .on_alias([](alias_event const& e){
+                throw std::runtime_error("alias *" + std::string(e.anchor()) + " can't be streamed to json");
+            })
+            .on_scalar([&](scalar_event const& e){
+                writer.on_scalar(e);
+            })
+            .on_sequence_start([&](sequence_start_event const&){
+                writer.on_start('[');
+            })
+            .on_sequence_end([&](sequence_end_event const&){
+                writer.on_end(']');
+            })
+            .on_mapping_start([&](mapping_start_event const&){
+                writer.on_start('{');
+            })
+            .on_mapping_end([&](mapping_end_event const&){
+                writer.on_end('}');
+            })
+            .parse()
+        ;
+        out.flush();
+    }
+
+    // json is yaml already; this rewrites any input in block style, keeping
+    // scalar styles so that quoted strings stay strings. stream events are
+    // left to the caller, so that several inputs can make one stream.
+    void to_yaml(yamlman::parser& parser, yamlman::emitter& emitter)
+    {
+        using namespace yamlman;
+
+        while(event const* e= parser.next())
+        {
+            switch(e->type())
+            {
+                case event_type::stream_start:
+                case event_type::stream_end:
+                    break;
+                case event_type::sequence_start:
+                {
+                    sequence_start_event s= e->get<sequence_start_event>();
+
+                    s.style(collection_style::block);
+                    emitter.emit(s);
+                    break;
+                }
+                case event_type::mapping_start:
+                {
+                    mapping_start_event m= e->get<mapping_start_event>();
+
+                    m.style(collection_style::block);
+                    emitter.emit(m);
+                    break;
+                }
+                default:
+                    emitter.emit(*e);
+                    break;
+            }
+        }
+    }
+
+    // json lines, as --to-json writes them, aren't a yaml stream; each line
+    // is parsed on its own and becomes a document of the output
+    void lines_to_yaml(yamlman::parser& parser, yamlman::mapped_file const* file, yamlman::emitter& emitter)
+    {
+        auto const line= [&](std::string_view l){
+            if(l.find_first_not_of(" \t\r") != std::string_view::npos)
+            {
+                parser.reset(l);
+                to_yaml(parser, emitter);
+            }
+        };
+
+        if(file)
+        {
+            std::string_view const input(file->data(), file->size());
+
+            for(std::size_t from= 0; from < input.size(); )
+            {
+                std::size_t const eol= std::min(input.find('\n', from), input.size());
+
+                line(input.substr(from, eol - from));
+                from= eol + 1;
+            }
+        }
+        else
+        {
+            std::string buffer;
+
+            while(std::getline(std::cin, buffer))
+            {
+                line(buffer);
+            }
+        }
+    }
+} // namespace
+
 int main(int argc, char const* argv[])
 {
     using namespace yamlman;
 
-    parser parser(std::cin);
-
-    parser
-        .on_stream_start([](stream_start_event const& e){
-            std::cout
-                << "[stream start]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << "[encoding: " << e.encoding() << "]"
-                << std::endl;
-        })
-        .on_document_start([](document_start_event const& e){
-            std::cout << "[document start]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << "[version: " << e.version_directive() << "]"
-                << std::endl;
-        })
-        .on_alias([](alias_event const& e){
-            std::cout << "[alias]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << "[anchor: " <<  e.anchor() << "]"
-                << std::endl;
-        })
-        .on_scalar([](scalar_event const& e){
-            std::cout << "[scalar]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << "[anchor: " << e.anchor() << "]"
-                << "[tag: " << e.tag() << "]"
-                << "[value: " << e.value() << "]"
-                << "[plain_implicit: " << e.plain_implicit() << "]"
-                << "[quoted_implicit: " << e.quoted_implicit() << "]"
-                << "[style: " << e.style() << "]"
-                << std::endl;
-        })
-        .on_mapping_start([](mapping_start_event const& e){
-            std::cout << "[mapping start]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << "[anchor: " << e.anchor() << "]"
-                << "[tag: " << e.tag() << "]"
-                << "[implicit: " << e.implicit() << "]"
-                << "[style: " << e.style() << "]"
-                << std::endl;
-        })
-        .on_mapping_end([](mapping_end_event const& e){
-            std::cout << "[mapping end]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << std::endl;
-        })
-        .on_sequence_start([](sequence_start_event const& e){
-            std::cout << "[sequence start]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << "[anchor: " << e.anchor() << "]"
-                << "[tag: " << e.tag() << "]"
-                << "[implicit: " << e.implicit() << "]"
-                << "[style: " << e.style() << "]"
-                << std::endl;
-        })
-        .on_sequence_end([](sequence_end_event const& e){
-            std::cout << "[sequence end]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << std::endl;
-        })
-        .on_document_end([](document_end_event const& e){
-            std::cout << "[document end]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << "[implicit: " << e.implicit() << "]"
-                << std::endl;
-        })
-        .on_stream_end([](stream_end_event const& e){
-            std::cout << "[stream end]"
-                << "[start: " << e.start_mark() << "]"
-                << "[end: " << e.end_mark() << "]"
-                << std::endl;
-        })
-        .parse()
-    ;
+    enum class mode
+    {
+        events,
+        json,
+        yaml,
+    } mode= mode::events;
+    bool lines= false;
+    char const* path= nullptr;
+    char const* const usage= "usage: yamler [--to-json | --to-yaml [--lines]] [file]\n";
+
+    for(int i= 1; i < argc; ++i)
+    {
+        std::string_view const arg(argv[i]);
+
+        if(arg == "--to-json")
+        {
+            mode= mode::json;
+        }
+        else if(arg == "--to-yaml")
+        {
+            mode= mode::yaml;
+        }
+        else if(arg == "--lines")
+        {
+            lines= true;
+        }
+        else if(arg.size() > 1 && arg[0] == '-')
+        {
+            std::cerr << usage;
+            return 2;
+        }
+        else if(arg != "-")
+        {
+            path= argv[i];
+        }
+    }
+    // --lines reads json lines; it means nothing to the other modes
+    if(lines && mode != mode::yaml)
+    {
+        std::cerr << usage;
+        return 2;
+    }
+
+    std::ios::sync_with_stdio(false);
+
+    try
+    {
+        std::unique_ptr<mapped_file> file;
+        parser parser;
+
+        if(path)
+        {
+            file.reset(new mapped_file(path));
+            parser.reset(*file).backend(backend::fast_path);
+        }
+        else
+        {
+            parser.reset(std::cin);
+        }
+        // a malformed input fails rather than ending early
+        parser.on_error([](parse_error const& e){
+            throw e;
+        });
+
+        switch(mode)
+        {
+            case mode::events:
+                print_events(parser);
+                break;
+            case mode::json:
+                to_json(parser);
+                break;
+            case mode::yaml:
+            {
+                emitter emitter(STDOUT_FILENO);
+
+                emitter.stream_start();
+                if(lines)
+                {
+                    lines_to_yaml(parser, file.get(), emitter);
+                }
+                else
+                {
+                    to_yaml(parser, emitter);
+                }
+                emitter.stream_end();
+                break;
+            }
+        }
+    }
+    catch(std::exception const& e)
+    {
+        std::cerr << "yamler: " << e.what() << '\n';
+        return 1;
+    }
 
     return 0;
 }
-